@@ -0,0 +1,266 @@
+/**
+ * junco_bench: measures the cost of junco::Log calls for each sink and mode.
+ *
+ * For every scenario, reports the latency of a single call (p50/p99/p999),
+ * the heap allocations made by the calling thread per call, and the throughput
+ * of 1, 4 and 16 threads logging at once.
+ *
+ * Usage: junco_bench [messages per thread]
+ *
+ * Messages are logged at the error level, so that they are kept by the
+ * default JC_LOG_LEVEL of release builds. Log output goes to the null device;
+ * results are printed to stdout. Latencies include the cost of reading the
+ * clock twice, which the "filtered at runtime" scenario mostly consists of.
+ * The socket scenario drains its records on another thread; records sent
+ * while that thread falls behind are dropped, as SocketSink does.
+ */
+#include "junco/binary_log.hpp"
+#include "junco/log.hpp"
+#include "junco/log_sinks.hpp"
+#include "junco/time.hpp"
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <latch>
+#include <memory>
+#include <new>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace {
+// Heap allocations made by the current thread, counted by operator new below
+thread_local std::size_t allocations = 0;
+
+#if defined(_WIN32)
+constexpr const char *null_device = "NUL";
+#else
+constexpr const char *null_device = "/dev/null";
+#endif
+
+struct Scenario {
+  std::string_view name;
+  void (*setup)();
+  void (*teardown)();
+};
+
+std::filesystem::path bench_file(std::string_view name) {
+  return std::filesystem::temp_directory_path() / name;
+}
+
+/**
+ * Receives the records of the socket scenario, so that the sink is measured
+ * against a live receiver.
+ */
+struct SocketDrain {
+  std::unique_ptr<junco::LogSocketReceiver> receiver;
+  std::atomic<bool> running{false};
+  std::thread thread;
+};
+SocketDrain socket_drain;
+
+void reset_logger() {
+  junco::StandardLogger::set_log_functions(junco::LogFunctions{});
+  junco::StandardLogger::set_level(junco::LogLevel::trace);
+}
+
+const Scenario scenarios[] = {
+    {"filtered at runtime",
+     [] { junco::StandardLogger::set_level(junco::LogLevel::fatal); },
+     reset_logger},
+    {"null sink",
+     [] {
+       junco::StandardLogger::set_log_functions(
+           junco::LogFunctions{.all = [](const junco::LogRecord &) {}});
+     },
+     reset_logger},
+    {"stderr", [] {}, [] {}},
+    {"stderr, buffered", [] { junco::StandardLogger::start_buffering(); },
+     [] { junco::StandardLogger::stop_buffering(); }},
+    {"stderr, async", [] { junco::StandardLogger::start_async(); },
+     [] { junco::StandardLogger::stop_async(); }},
+    {"stderr, async deferred",
+     [] {
+       junco::StandardLogger::start_async({.deferred_formatting = true});
+     },
+     [] { junco::StandardLogger::stop_async(); }},
+    {"mapped file",
+     [] {
+       junco::MappedFileSink::open(bench_file("junco_bench.log"),
+                                   {.capacity = 256 * 1024 * 1024,
+                                    .max_files = 1});
+       junco::StandardLogger::set_log_functions(
+           junco::MappedFileSink::functions());
+     },
+     [] {
+       reset_logger();
+       junco::MappedFileSink::close();
+       std::filesystem::remove(bench_file("junco_bench.log"));
+       std::filesystem::remove(bench_file("junco_bench.log.1"));
+     }},
+    {"binary file",
+     [] {
+       junco::BinaryLogSink::open(bench_file("junco_bench.jclog"));
+       junco::StandardLogger::set_log_functions(
+           junco::BinaryLogSink::functions());
+     },
+     [] {
+       reset_logger();
+       junco::BinaryLogSink::close();
+       std::filesystem::remove(bench_file("junco_bench.jclog"));
+     }},
+    {"binary file, compressed",
+     [] {
+       junco::BinaryLogSink::open(bench_file("junco_bench.jclog"),
+                                  {.compress = true});
+       junco::StandardLogger::set_log_functions(
+           junco::BinaryLogSink::functions());
+     },
+     [] {
+       reset_logger();
+       junco::BinaryLogSink::close();
+       std::filesystem::remove(bench_file("junco_bench.jclog"));
+     }},
+    {"socket",
+     [] {
+       auto path = bench_file("junco_bench.sock");
+       socket_drain.receiver =
+           std::make_unique<junco::LogSocketReceiver>(path);
+       socket_drain.running = true;
+       socket_drain.thread = std::thread([] {
+         auto record = std::string();
+         while (socket_drain.running.load(std::memory_order_relaxed))
+           socket_drain.receiver->receive(record, 0.01);
+       });
+       junco::SocketSink::open(path);
+       junco::StandardLogger::set_log_functions(
+           junco::SocketSink::functions());
+     },
+     [] {
+       reset_logger();
+       junco::SocketSink::close();
+       socket_drain.running = false;
+       socket_drain.thread.join();
+       socket_drain.receiver.reset();
+     }},
+};
+
+void log_message(int i) {
+  junco::Log::error("entity {} moved to ({:.2f}, {:.2f}) in {}", i, i * 0.5,
+                    i * 0.25, "zone");
+}
+
+struct LatencyResult {
+  double p50, p99, p999;
+  double allocations_per_call;
+};
+
+LatencyResult measure_latency(const junco::Clock &clock, int calls) {
+  auto samples = std::vector<junco::Clock::duration::rep>(calls);
+  auto allocations_before = allocations;
+  for (int i = 0; i < calls; ++i) {
+    auto start = clock.now_ticks();
+    log_message(i);
+    samples[i] = clock.now_ticks() - start;
+  }
+  auto allocated = allocations - allocations_before;
+  junco::Log::flush();
+
+  std::ranges::sort(samples);
+  auto percentile = [&](double p) {
+    auto index = static_cast<std::size_t>(p * (samples.size() - 1));
+    return junco::Clock::to_seconds(samples[index]) * 1e9;
+  };
+  return LatencyResult{.p50 = percentile(0.5),
+                       .p99 = percentile(0.99),
+                       .p999 = percentile(0.999),
+                       .allocations_per_call =
+                           static_cast<double>(allocated) / calls};
+}
+
+/**
+ * Returns the messages per second written by thread_count threads logging
+ * calls messages each, including the time taken to flush them.
+ */
+double measure_throughput(const junco::Clock &clock, int thread_count,
+                          int calls) {
+  auto ready = std::latch(thread_count + 1);
+  auto threads = std::vector<std::thread>();
+  for (int t = 0; t < thread_count; ++t) {
+    threads.emplace_back([&ready, calls] {
+      ready.arrive_and_wait();
+      for (int i = 0; i < calls; ++i)
+        log_message(i);
+    });
+  }
+  auto stopwatch = junco::Stopwatch(clock);
+  stopwatch.start();
+  ready.arrive_and_wait();
+  for (auto &thread : threads)
+    thread.join();
+  junco::Log::flush();
+  auto elapsed = stopwatch.stop();
+  return thread_count * static_cast<double>(calls) / elapsed;
+}
+} // namespace
+
+void *operator new(std::size_t size) {
+  ++allocations;
+  if (auto *memory = std::malloc(size == 0 ? 1 : size))
+    return memory;
+  throw std::bad_alloc();
+}
+void operator delete(void *memory) noexcept { std::free(memory); }
+void operator delete(void *memory, std::size_t) noexcept {
+  ::operator delete(memory);
+}
+
+int main(int argc, char **argv) {
+  auto calls = 20000;
+  if (argc > 1) {
+    auto arg = std::string_view(argv[1]);
+    auto *last = arg.data() + arg.size();
+    auto [end, ec] = std::from_chars(arg.data(), last, calls);
+    if (ec != std::errc() || end != last || calls <= 0) {
+      std::cerr << "Usage: junco_bench [messages per thread]\n";
+      return 2;
+    }
+  }
+  if (!junco::log_level_compiled(junco::LogLevel::error)) {
+    std::cerr << "junco_bench: error messages are compiled out (see "
+                 "JC_LOG_LEVEL)\n";
+    return 1;
+  }
+  // Messages are written to stderr by the default log functions
+  if (!std::freopen(null_device, "w", stderr)) {
+    std::cout << "junco_bench: cannot redirect stderr to " << null_device
+              << "\n";
+    return 1;
+  }
+
+  const auto clock = junco::Clock();
+  std::cout << std::format(
+      "{:<24}{:>10}{:>10}{:>11}{:>13}{:>14}{:>14}{:>14}\n", "scenario",
+      "p50 (ns)", "p99 (ns)", "p999 (ns)", "allocs/call", "1 thread/s",
+      "4 threads/s", "16 threads/s");
+  for (const auto &scenario : scenarios) {
+    scenario.setup();
+    auto latency = measure_latency(clock, calls);
+    std::cout << std::format("{:<24}{:>10.0f}{:>10.0f}{:>11.0f}{:>13.2f}",
+                             scenario.name, latency.p50, latency.p99,
+                             latency.p999, latency.allocations_per_call);
+    for (auto thread_count : {1, 4, 16})
+      std::cout << std::format("{:>14.3g}",
+                               measure_throughput(clock, thread_count, calls));
+    std::cout << std::endl;
+    scenario.teardown();
+  }
+  return 0;
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+/**
+ * junco_profiler_bench: measures the cost of recording a junco::ProfileScope.
+ *
+ * Usage: junco_profiler_bench [zones per frame]
+ *
+ * Records frames of empty zones, nested two deep, and reports the average
+ * time taken per zone, and the time end_frame() takes to collect them.
+ * ProfileScope is used directly, so results do not depend on
+ * JC_ENABLE_PROFILING.
+ */
+#include "junco/profiler.hpp"
+#include "junco/time.hpp"
+#include <charconv>
+#include <format>
+#include <iostream>
+#include <string_view>
+
+int main(int argc, char **argv) {
+  // Leave room in the buffer for every zone of a frame
+  auto zones = static_cast<int>(junco::Profiler::buffer_capacity / 2 - 2);
+  if (argc > 1) {
+    auto arg = std::string_view(argv[1]);
+    auto *last = arg.data() + arg.size();
+    auto [end, ec] = std::from_chars(arg.data(), last, zones);
+    if (ec != std::errc() || end != last || zones <= 1) {
+      std::cerr << "Usage: junco_profiler_bench [zones per frame]\n";
+      return 2;
+    }
+  }
+
+  constexpr auto frames = 100;
+  auto recording = junco::TscClock::duration();
+  auto collecting = junco::TscClock::duration();
+  auto dropped = std::size_t{0};
+  junco::Profiler::end_frame();
+  for (int frame = 0; frame < frames; ++frame) {
+    auto start = junco::TscClock::now();
+    for (int i = 0; i < zones / 2; ++i) {
+      auto outer = junco::ProfileScope("outer");
+      auto inner = junco::ProfileScope("inner");
+    }
+    auto recorded = junco::TscClock::now();
+    dropped += junco::Profiler::end_frame().dropped_zones;
+    recording += recorded - start;
+    collecting += junco::TscClock::now() - recorded;
+  }
+
+  auto per_zone = static_cast<double>(recording.count()) /
+                  (static_cast<double>(frames) * (zones / 2 * 2));
+  std::cout << std::format("{:<24}{:>10.1f}\n", "ns per zone", per_zone);
+  std::cout << std::format("{:<24}{:>10.1f}\n", "us per end_frame()",
+                           collecting.count() / (frames * 1000.0));
+  if (dropped != 0)
+    std::cout << std::format("{} zones dropped\n", dropped);
+  std::cout << std::format("{:<24}{:>10}\n", "timestamp counter",
+                           junco::TscClock::uses_counter() ? "yes" : "no");
+  return 0;
+}
\ No newline at end of file
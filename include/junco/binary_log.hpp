@@ -0,0 +1,115 @@
+/**
+ * @file junco/binary_log.hpp
+ *
+ * Defines junco's binary log format, a sink that writes it, and a decoder that
+ * renders it back to text (see the junco_logdecode tool).
+ *
+ * Binary logs store each format string once, in a table, and every record as
+ * the arguments captured by DeferredFormat, so writing a record takes a few
+ * copies and far fewer bytes than its formatted text.
+ *
+ * Layout, in native byte order:
+ * - Header: "JCBLOG", format version (u8), sizeof(std::size_t) (u8), byte
+ *   order mark 0x01020304 (u32), then the numerator and denominator of the
+ *   clock period (u64 each).
+ * - Any number of entries, each starting with a tag byte:
+ *   - 'F' (format): id (u32), argument count (u8), the DeferredType of each
+ *     argument (u8 each), then the length (u32) and text of the format string.
+ *   - 'R' (record): level (u8), flags (u8; 1 if timestamped, 2 if the thread
+ *     is known, 4 if it has fields), timestamp (i64) and thread (u32) if
+ *     flagged, format id (u32), the size (u32) and bytes of the arguments,
+ *     then, if flagged, the number of fields (u32) and each field: the length
+ *     (u32) and text of its key, its LogField::Type (u8), and its value (u8
+ *     for booleans, i64, u64 or f64 for numbers, or the length (u32) and text
+ *     of a string).
+ *   - 'B' (block): earliest and latest timestamp of its records (i64 each;
+ *     earliest > latest if none are timestamped), uncompressed and compressed
+ *     size (u32 each), then 'R' entries compressed with compress_block().
+ * Format id 0 marks records that were formatted before being written, whose
+ * arguments are the message text. Fields attached through StructuredLog keep
+ * their types, and are rendered as by format_log_fields(). Formats are never
+ * compressed, and always precede the first block that uses them, so every
+ * block can be decoded (or skipped, by timestamp) on its own.
+ */
+#pragma once
+
+#include "junco/log.hpp" // junco::LogFunctions, junco::LogRecord
+#include <cstddef>       // std::size_t
+#include <cstdint>       // std::uint32_t
+#include <filesystem>    // std::filesystem::path
+#include <iosfwd>        // std::istream, std::ostream
+#include <optional>      // std::optional
+
+namespace junco {
+/**
+ * Selects which records are rendered by decode_binary_log().
+ */
+struct BinaryLogFilter {
+  LogLevel minimum = LogLevel::trace;
+  // Time range, in seconds of the writer's clock. When either end is set,
+  // records without a timestamp are skipped.
+  std::optional<double> from;
+  std::optional<double> to;
+  std::optional<std::uint32_t> thread;
+};
+
+/**
+ * Configuration for BinaryLogSink.
+ */
+struct BinaryLogSettings {
+  // Whether records are written in compressed blocks. Blocks are compressed
+  // and written by a background thread.
+  bool compress = false;
+  // Uncompressed size of a block. Smaller blocks let the decoder skip more
+  // precisely by time, larger blocks compress better.
+  std::size_t block_size = 64 * 1024;
+};
+
+/**
+ * Writes records to a binary log file (see the layout above).
+ * Records are buffered and written in large blocks. Messages whose arguments
+ * cannot be decoded offline, or whose format has dynamic widths or precisions
+ * (like "{:{}}"), are formatted and stored as text instead.
+ * @note Timestamps and thread indices are only stored if enabled through
+ * StandardLogger::set_record_options().
+ */
+class BinaryLogSink final {
+public:
+  /**
+   * Creates (or truncates) the file at path and writes the header.
+   * Returns false if the sink is already open or the file could not be
+   * created.
+   */
+  static bool open(const std::filesystem::path &path,
+                   const BinaryLogSettings &settings = {}) noexcept;
+  /**
+   * Writes any buffered records and closes the file.
+   */
+  static void close() noexcept;
+  static bool is_open() noexcept;
+
+  static void write(const LogRecord &record) noexcept;
+  /**
+   * Returns log functions which send every channel to this sink, unformatted
+   * whenever possible.
+   */
+  static LogFunctions functions() noexcept {
+    return LogFunctions{.trace = nullptr,
+                        .standard = nullptr,
+                        .warning = nullptr,
+                        .error = nullptr,
+                        .fatal = nullptr,
+                        .all = write,
+                        .accepts_deferred = true};
+  }
+};
+
+/**
+ * Renders the records of a binary log selected by filter as text, one line per
+ * record. Returns false if the input is not a binary log or is cut short; lines
+ * decoded up to that point are still written. Compressed blocks entirely
+ * outside the filter's time range are skipped without being decompressed.
+ */
+bool decode_binary_log(std::istream &in, std::ostream &out,
+                       const BinaryLogFilter &filter = {}) noexcept;
+} // namespace junco
\ No newline at end of file
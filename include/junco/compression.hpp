@@ -0,0 +1,30 @@
+/**
+ * @file junco/compression.hpp
+ *
+ * Defines a fast block compressor, used by junco's binary log files.
+ *
+ * Compressed blocks follow the LZ4 block format (literal runs and matches of
+ * at least 4 bytes, at most 65535 bytes back), favoring speed over ratio: the
+ * compressor keeps a single candidate per hash and extends matches greedily.
+ * Each block is self-contained, so blocks can be decompressed in any order.
+ */
+#pragma once
+
+#include <cstddef>     // std::size_t
+#include <string>      // std::string
+#include <string_view> // std::string_view
+
+namespace junco {
+/**
+ * Appends the compressed form of input to out.
+ */
+void compress_block(std::string_view input, std::string &out) noexcept;
+
+/**
+ * Replaces the contents of out with the decompressed form of input, which
+ * must decompress to exactly size bytes. Returns false if input is not a valid
+ * compressed block of that size.
+ */
+bool decompress_block(std::string_view input, std::size_t size,
+                      std::string &out) noexcept;
+} // namespace junco
\ No newline at end of file
@@ -0,0 +1,240 @@
+/**
+ * @file junco/deferred_format.hpp
+ *
+ * Defines DeferredFormat, which captures a format string along with a copy of
+ * its arguments so that formatting can happen later (usually on another
+ * thread).
+ *
+ * Capturing a message is a handful of memcpy calls into fixed-size storage, so
+ * it is much cheaper than formatting it on the calling thread.
+ */
+#pragma once
+
+#include <array>       // std::array
+#include <concepts>    // std::convertible_to
+#include <cstddef>     // std::byte, std::size_t
+#include <cstdint>     // std::uint8_t
+#include <cstring>     // std::memcpy
+#include <exception>   // std::exception
+#include <format>      // std::format_string, std::vformat_to
+#include <iterator>    // std::back_inserter
+#include <span>        // std::span
+#include <string>      // std::string
+#include <string_view> // std::string_view
+#include <tuple>       // std::tuple, std::apply
+#include <type_traits> // std::is_trivially_copyable_v
+
+namespace junco {
+/**
+ * Arguments whose characters are copied into the capture, and are formatted
+ * as std::string_view.
+ */
+template <typename T>
+concept DeferredString = std::convertible_to<const T &, std::string_view>;
+
+/**
+ * Arguments that are copied byte-for-byte into the capture.
+ * Pointers are only allowed when they point to void, since those are
+ * formatted by address rather than by what they point to.
+ */
+template <typename T>
+concept DeferredValue =
+    std::is_trivially_copyable_v<T> && std::is_default_constructible_v<T> &&
+    !DeferredString<T> &&
+    (!std::is_pointer_v<T> || std::is_void_v<std::remove_pointer_t<T>>);
+
+template <typename T>
+concept Deferrable = DeferredString<std::remove_cvref_t<T>> ||
+                     DeferredValue<std::remove_cvref_t<T>>;
+
+/**
+ * Describes how a captured argument is stored, so that captures can be
+ * decoded without knowing the types they were made from (for example, by a
+ * tool reading a binary log file).
+ */
+enum class DeferredType : std::uint8_t {
+  // Any other trivially copyable type; only formattable by the capture itself
+  other,
+  boolean,
+  character,
+  int8,
+  int16,
+  int32,
+  int64,
+  uint8,
+  uint16,
+  uint32,
+  uint64,
+  float32,
+  float64,
+  pointer,
+  // A std::size_t length followed by that many characters
+  string
+};
+
+/**
+ * Returns how arguments of type T are stored once captured.
+ */
+template <typename T> consteval DeferredType deferred_type() noexcept {
+  using Type = DeferredType;
+  if constexpr (DeferredString<T>)
+    return Type::string;
+  else if constexpr (std::same_as<T, bool>)
+    return Type::boolean;
+  else if constexpr (std::same_as<T, char>)
+    return Type::character;
+  else if constexpr (std::signed_integral<T>)
+    return sizeof(T) == 1   ? Type::int8
+           : sizeof(T) == 2 ? Type::int16
+           : sizeof(T) == 4 ? Type::int32
+                            : Type::int64;
+  else if constexpr (std::unsigned_integral<T>)
+    return sizeof(T) == 1   ? Type::uint8
+           : sizeof(T) == 2 ? Type::uint16
+           : sizeof(T) == 4 ? Type::uint32
+                            : Type::uint64;
+  else if constexpr (std::same_as<T, float>)
+    return Type::float32;
+  else if constexpr (std::same_as<T, double>)
+    return Type::float64;
+  else if constexpr (std::is_pointer_v<T>)
+    return Type::pointer;
+  else
+    return Type::other;
+}
+
+/**
+ * A format string and a copy of its arguments, which can be formatted later.
+ * Only arguments satisfying Deferrable can be captured.
+ */
+class DeferredFormat final {
+public:
+  // Bytes available for captured arguments
+  static constexpr std::size_t capacity = 224;
+  static constexpr std::size_t max_arguments = 16;
+
+  /**
+   * Copies the format string and arguments into this object.
+   * Returns false (and remains empty) if the arguments do not fit.
+   * @note The format string itself is not copied, and must outlive this
+   * object. String literals always do.
+   */
+  template <typename... Args>
+    requires(Deferrable<Args> && ...)
+  bool capture(std::format_string<Args...> fmt, const Args &...args) noexcept {
+    if constexpr (sizeof...(Args) > max_arguments) {
+      return false;
+    } else {
+      std::size_t offset = 0;
+      if (!(store(offset, args) && ...))
+        return false;
+      format_function = &format_stored<stored_type<Args>...>;
+      format_string = fmt.get();
+      stored_size = offset;
+      argument_count = sizeof...(Args);
+      argument_types = {deferred_type<std::remove_cvref_t<Args>>()...};
+      return true;
+    }
+  }
+
+  /**
+   * Formats the captured message, appending it to out.
+   */
+  void format_to(std::string &out) const noexcept {
+    if (format_function)
+      format_function(out, format_string, data.data());
+  }
+  std::string format() const noexcept {
+    auto out = std::string{};
+    format_to(out);
+    return out;
+  }
+
+  bool empty() const noexcept { return format_function == nullptr; }
+
+  std::string_view get_format() const noexcept { return format_string; }
+  /**
+   * Returns the type of each captured argument, in order.
+   */
+  std::span<const DeferredType> types() const noexcept {
+    return std::span(argument_types.data(), argument_count);
+  }
+  /**
+   * Returns the captured arguments, stored one after the other as described
+   * by types().
+   */
+  std::span<const std::byte> arguments() const noexcept {
+    return std::span(data.data(), stored_size);
+  }
+
+private:
+  using FormatFunction = void (*)(std::string &, std::string_view,
+                                  const std::byte *);
+
+  template <typename T>
+  using stored_type =
+      std::conditional_t<DeferredString<std::remove_cvref_t<T>>,
+                         std::string_view, std::remove_cvref_t<T>>;
+
+  template <typename T>
+  bool store(std::size_t &offset, const T &arg) noexcept {
+    if constexpr (DeferredString<T>) {
+      auto str = std::string_view(arg);
+      auto size = str.size();
+      if (offset + sizeof(size) + size > capacity)
+        return false;
+      std::memcpy(data.data() + offset, &size, sizeof(size));
+      std::memcpy(data.data() + offset + sizeof(size), str.data(), size);
+      offset += sizeof(size) + size;
+    } else {
+      if (offset + sizeof(T) > capacity)
+        return false;
+      std::memcpy(data.data() + offset, &arg, sizeof(T));
+      offset += sizeof(T);
+    }
+    return true;
+  }
+
+  template <typename T>
+  static T load(const std::byte *bytes, std::size_t &offset) noexcept {
+    if constexpr (std::same_as<T, std::string_view>) {
+      std::size_t size;
+      std::memcpy(&size, bytes + offset, sizeof(size));
+      auto str = std::string_view(
+          reinterpret_cast<const char *>(bytes + offset + sizeof(size)), size);
+      offset += sizeof(size) + size;
+      return str;
+    } else {
+      T value;
+      std::memcpy(&value, bytes + offset, sizeof(T));
+      offset += sizeof(T);
+      return value;
+    }
+  }
+
+  template <typename... Stored>
+  static void format_stored(std::string &out, std::string_view fmt,
+                            const std::byte *bytes) noexcept {
+    std::size_t offset = 0;
+    // Braced initialization guarantees left-to-right evaluation
+    auto values = std::tuple<Stored...>{load<Stored>(bytes, offset)...};
+    try {
+      std::apply(
+          [&](const auto &...args) {
+            std::vformat_to(std::back_inserter(out), fmt,
+                            std::make_format_args(args...));
+          },
+          values);
+    } catch (const std::exception &e) {
+      out.append("<format error: ").append(e.what()).append(">");
+    }
+  }
+
+  FormatFunction format_function = nullptr;
+  std::string_view format_string;
+  std::size_t stored_size = 0;
+  std::uint8_t argument_count = 0;
+  std::array<DeferredType, max_arguments> argument_types;
+  std::array<std::byte, capacity> data;
+};
+} // namespace junco
\ No newline at end of file
@@ -10,21 +10,186 @@
  */
 #pragma once
 
-#include <concepts>   // concepts
-#include <format>     // std::format, std::format_string
-#include <iostream>   // std::cout, std::cerr
-#include <syncstream> // std::osyncstream
+#include "junco/deferred_format.hpp" // junco::DeferredFormat
+#include "junco/time.hpp"            // junco::Clock
+#include <array>            // std::array
+#include <atomic>           // std::atomic
+#include <concepts>         // concepts
+#include <cstddef>          // std::size_t
+#include <cstdint>          // std::uint8_t
+#include <format>           // std::format, std::format_string
+#include <initializer_list> // std::initializer_list
+#include <iostream>         // std::cout, std::cerr
+#include <source_location>  // std::source_location
+#include <span>             // std::span
+#include <string>           // std::string
+#include <string_view>      // std::string_view
+#include <syncstream>       // std::osyncstream
+#include <type_traits>      // std::type_identity_t
+#include <vector>           // std::vector
 
-#if defined(JC_BUILD_DEBUG)
-#define JC_ENABLE_LOGGING
+// Minimum level compiled into LoggerTraits, from 0 (trace) to 4 (fatal), or 5
+// to remove logging entirely. Normally set through CMake (see JC_LOG_LEVEL in
+// docs/building.md); otherwise Debug and RelWithDebInfo builds keep every
+// message, Release builds keep errors and fatal errors, and others do not log.
+#if !defined(JC_LOG_LEVEL)
+#if defined(JC_BUILD_DEBUG) || defined(JC_BUILD_RELWITHDEBINFO)
+#define JC_LOG_LEVEL 0
+#elif defined(JC_BUILD_RELEASE)
+#define JC_LOG_LEVEL 3
+#else
+#define JC_LOG_LEVEL 5
+#endif
 #endif
-#if defined(JC_BUILD_RELWITHDEBINFO)
+#if JC_LOG_LEVEL < 5
 #define JC_ENABLE_LOGGING
 #endif
-#if defined(JC_RELEASE)
+
+// Logging macros for junco::Log. Unlike calling junco::Log directly, calls
+// below JC_LOG_LEVEL are removed by the preprocessor, so their arguments are
+// never evaluated.
+#if JC_LOG_LEVEL <= 0
+#define JC_LOG_TRACE(...) ::junco::Log::trace(__VA_ARGS__)
+#else
+#define JC_LOG_TRACE(...) ((void)0)
+#endif
+#if JC_LOG_LEVEL <= 1
+#define JC_LOG_STANDARD(...) ::junco::Log::standard(__VA_ARGS__)
+#else
+#define JC_LOG_STANDARD(...) ((void)0)
 #endif
+#if JC_LOG_LEVEL <= 2
+#define JC_LOG_WARNING(...) ::junco::Log::warning(__VA_ARGS__)
+#else
+#define JC_LOG_WARNING(...) ((void)0)
+#endif
+#if JC_LOG_LEVEL <= 3
+#define JC_LOG_ERROR(...) ::junco::Log::error(__VA_ARGS__)
+#else
+#define JC_LOG_ERROR(...) ((void)0)
+#endif
+#if JC_LOG_LEVEL <= 4
+#define JC_LOG_FATAL(...) ::junco::Log::fatal(__VA_ARGS__)
+#else
+#define JC_LOG_FATAL(...) ((void)0)
+#endif
+
+// Declares a junco::LogSite private to the call site, built from the given
+// LogLimit fields, e.g.
+//   junco::Log::warning(JC_LOG_SITE(.per_second = 10), "no mesh on {}", id);
+#define JC_LOG_SITE(...)                                                       \
+  ([]() noexcept -> ::junco::LogSite & {                                       \
+    static ::junco::LogSite site{::junco::LogLimit{__VA_ARGS__}};              \
+    return site;                                                               \
+  }())
 
 namespace junco {
+/**
+ * Severity of a log message, ordered from least to most severe.
+ */
+enum class LogLevel : std::uint8_t { trace, standard, warning, error, fatal };
+
+/**
+ * Whether messages of the given level are compiled in (see JC_LOG_LEVEL).
+ */
+constexpr bool log_level_compiled(LogLevel level) noexcept {
+  return static_cast<int>(level) >= JC_LOG_LEVEL;
+}
+
+/**
+ * Returns a bit mask with one bit set for every level at or above minimum.
+ */
+constexpr std::uint8_t log_levels_from(LogLevel minimum) noexcept {
+  return static_cast<std::uint8_t>((0x1Fu << static_cast<int>(minimum)) &
+                                   0x1Fu);
+}
+
+/**
+ * Names a subsystem, so that its messages can be filtered separately from the
+ * rest of the engine. Tags are meant to live for the whole program:
+ *   inline junco::LogTag physics_log{"physics", junco::LogLevel::warning};
+ *   junco::Log::trace(physics_log, "contacts: {}", count);
+ * A tagged message is only sent if it passes both the tag's threshold and
+ * StandardLogger's global threshold. Both are folded into a single atomic mask,
+ * so the check costs one relaxed load.
+ */
+class LogTag final {
+public:
+  explicit LogTag(std::string_view name,
+                  LogLevel minimum = LogLevel::trace) noexcept;
+  ~LogTag();
+  LogTag(const LogTag &) = delete;
+  void operator=(const LogTag &) = delete;
+
+  std::string_view name() const noexcept { return tag_name; }
+  void set_level(LogLevel minimum) noexcept;
+  bool enabled(LogLevel level) const noexcept {
+    return (mask.load(std::memory_order_relaxed) >> static_cast<int>(level)) &
+           1u;
+  }
+
+private:
+  friend class StandardLogger;
+  // Recomputes mask from this tag's threshold and the given global mask
+  void refresh(std::uint8_t global_mask) noexcept;
+
+  std::string_view tag_name;
+  LogLevel threshold;
+  std::atomic<std::uint8_t> mask;
+  LogTag *next = nullptr;
+};
+
+/**
+ * Limits on how often a single call site may send messages.
+ */
+struct LogLimit {
+  // Messages sent per second, or 0 for no limit
+  std::uint32_t per_second = 0;
+  // Whether messages identical to the previous one from the site are dropped
+  bool collapse_repeats = false;
+};
+
+/**
+ * The state of a rate-limited call site (see JC_LOG_SITE). Suppressed messages
+ * are counted, and the next message sent from the site is preceded by a
+ * "suppressed N similar messages" summary.
+ * @note Checks are a few relaxed atomic operations, and are best-effort when
+ * several threads log from the same site at once.
+ */
+class LogSite final {
+public:
+  explicit constexpr LogSite(const LogLimit &limit) noexcept : limit(limit) {}
+  LogSite(const LogSite &) = delete;
+  LogSite &operator=(const LogSite &) = delete;
+
+  const LogLimit &get_limit() const noexcept { return limit; }
+  /**
+   * Counts a message against the rate limit. Returns false (and counts the
+   * message as suppressed) if the site has used up its messages for the
+   * current second.
+   */
+  bool admit() noexcept;
+  /**
+   * Returns true (and counts the message as suppressed) if repeats are
+   * collapsed and msg is identical to the previous message from this site.
+   */
+  bool repeats(std::string_view msg) noexcept;
+  /**
+   * Returns the number of messages suppressed since the last call.
+   */
+  std::uint32_t take_suppressed() noexcept {
+    return suppressed.exchange(0, std::memory_order_relaxed);
+  }
+
+private:
+  LogLimit limit;
+  // Second (of std::chrono::steady_clock) that window_count refers to
+  std::atomic<std::int64_t> window{-1};
+  std::atomic<std::uint32_t> window_count{0};
+  std::atomic<std::uint32_t> suppressed{0};
+  std::atomic<std::uint64_t> last_hash{0};
+};
+
 template <typename T>
 concept Logger = requires(std::string msg) {
   { T::trace(msg) } -> std::same_as<void>;
@@ -34,62 +199,446 @@ concept Logger = requires(std::string msg) {
   { T::fatal(msg) } -> std::same_as<void>;
 };
 
+/**
+ * Loggers that accept messages as std::string_view. LoggerTraits formats
+ * messages for these into a thread-local buffer instead of a std::string, so
+ * logging does not allocate.
+ */
+template <typename T>
+concept ViewLogger = Logger<T> && requires(std::string_view msg) {
+  { T::trace(msg) } -> std::same_as<void>;
+  { T::standard(msg) } -> std::same_as<void>;
+  { T::warning(msg) } -> std::same_as<void>;
+  { T::error(msg) } -> std::same_as<void>;
+  { T::fatal(msg) } -> std::same_as<void>;
+};
+
+/**
+ * Loggers that accept the call site of each message alongside it.
+ */
+template <typename T>
+concept LocatingLogger =
+    requires(std::string_view msg, std::source_location location) {
+      { T::trace(msg, location) } -> std::same_as<void>;
+      { T::standard(msg, location) } -> std::same_as<void>;
+      { T::warning(msg, location) } -> std::same_as<void>;
+      { T::error(msg, location) } -> std::same_as<void>;
+      { T::fatal(msg, location) } -> std::same_as<void>;
+    };
+
+/**
+ * Loggers that can reject messages before they are formatted.
+ */
+template <typename T>
+concept FilteringLogger = requires(LogLevel level) {
+  { T::enabled(level) } -> std::same_as<bool>;
+};
+
+/**
+ * Loggers that hold on to messages, and can be asked to write them out.
+ */
+template <typename T>
+concept FlushingLogger = requires {
+  { T::flush() } -> std::same_as<void>;
+};
+
+/**
+ * Loggers that can accept messages before they are formatted.
+ * can_defer() is checked first, so that arguments are only captured when the
+ * logger is able to format them later.
+ */
+template <typename T>
+concept DeferringLogger = requires(LogLevel level, DeferredFormat message,
+                                   std::source_location location) {
+  { T::can_defer(level) } -> std::same_as<bool>;
+  { T::defer(level, message, location) } -> std::same_as<bool>;
+};
+
+/**
+ * A format string along with the location it was written at. Both are
+ * resolved at compile time: the location is filled in by a default argument
+ * evaluated at the call site, so capturing it costs nothing at runtime.
+ * @note With common standard libraries, std::source_location is a single
+ * pointer to static data generated by the compiler.
+ */
+template <typename... Args> struct BasicLogFormat {
+  template <typename S>
+    requires std::convertible_to<const S &, std::string_view>
+  consteval BasicLogFormat(const S &fmt, std::source_location location =
+                                             std::source_location::current())
+      : format(fmt), location(location) {}
+  constexpr BasicLogFormat(
+      std::format_string<Args...> fmt,
+      std::source_location location = std::source_location::current())
+      : format(fmt), location(location) {}
+
+  std::format_string<Args...> format;
+  std::source_location location;
+};
+// Format string type used by LoggerTraits, which only deduces Args from the
+// arguments themselves (like std::format_string)
+template <typename... Args>
+using LogFormat = BasicLogFormat<std::type_identity_t<Args>...>;
+
 /**
  * Provides a common interface for sending messages through a Logger object.
  * LoggerTraits handles formatting and inlining, so that log methods are only
- * included in source files when logging is enabled.
+ * included in source files when their level is compiled in (see JC_LOG_LEVEL).
+ * If the Logger supports it, messages are filtered at runtime before being
+ * formatted, and messages whose arguments are all Deferrable are handed over
+ * unformatted to be formatted later by the Logger.
+ * Every channel may also be given a LogTag, whose threshold is checked instead,
+ * or a LogSite, which limits how often the call site sends messages.
+ * The call site of every message is passed along to Loggers that accept it
+ * (see LocatingLogger).
+ * @note Arguments to a compiled-out call are still evaluated; use the
+ * JC_LOG_* macros to remove them as well.
  */
 template <Logger T> class LoggerTraits final {
 public:
+  // Longest message (in bytes) that can be formatted without allocating, when
+  // T is a ViewLogger
+  static constexpr std::size_t buffer_capacity = 1024;
+
   template <typename... Args>
-  inline static void trace(std::format_string<Args...> fmt,
+  inline static void trace(LogFormat<Args...> fmt,
                            Args &&...args) noexcept {
-#ifdef JC_ENABLE_LOGGING
-    auto message = std::format(fmt, std::forward<Args>(args)...);
-    T::trace(message);
-#endif
+    write<LogLevel::trace>(nullptr, nullptr, fmt, std::forward<Args>(args)...);
+  }
+  template <typename... Args>
+  inline static void trace(const LogTag &tag,
+                           LogFormat<Args...> fmt,
+                           Args &&...args) noexcept {
+    write<LogLevel::trace>(&tag, nullptr, fmt, std::forward<Args>(args)...);
+  }
+  template <typename... Args>
+  inline static void trace(LogSite &site, LogFormat<Args...> fmt,
+                           Args &&...args) noexcept {
+    write<LogLevel::trace>(nullptr, &site, fmt, std::forward<Args>(args)...);
   }
   template <typename... Args>
-  inline static void standard(std::format_string<Args...> fmt,
+  inline static void standard(LogFormat<Args...> fmt,
                               Args &&...args) noexcept {
-#ifdef JC_ENABLE_LOGGING
-    auto message = std::format(fmt, std::forward<Args>(args)...);
-    T::standard(message);
-#endif
+    write<LogLevel::standard>(nullptr, nullptr, fmt,
+                              std::forward<Args>(args)...);
+  }
+  template <typename... Args>
+  inline static void standard(const LogTag &tag,
+                              LogFormat<Args...> fmt,
+                              Args &&...args) noexcept {
+    write<LogLevel::standard>(&tag, nullptr, fmt, std::forward<Args>(args)...);
+  }
+  template <typename... Args>
+  inline static void standard(LogSite &site, LogFormat<Args...> fmt,
+                              Args &&...args) noexcept {
+    write<LogLevel::standard>(nullptr, &site, fmt, std::forward<Args>(args)...);
   }
   template <typename... Args>
-  inline static void warning(std::format_string<Args...> fmt,
+  inline static void warning(LogFormat<Args...> fmt,
                              Args &&...args) noexcept {
-#ifdef JC_ENABLE_LOGGING
-    auto message = std::format(fmt, std::forward<Args>(args)...);
-    T::warning(message);
-#endif
+    write<LogLevel::warning>(nullptr, nullptr, fmt,
+                             std::forward<Args>(args)...);
+  }
+  template <typename... Args>
+  inline static void warning(const LogTag &tag,
+                             LogFormat<Args...> fmt,
+                             Args &&...args) noexcept {
+    write<LogLevel::warning>(&tag, nullptr, fmt, std::forward<Args>(args)...);
   }
   template <typename... Args>
-  inline static void error(std::format_string<Args...> fmt,
+  inline static void warning(LogSite &site, LogFormat<Args...> fmt,
+                             Args &&...args) noexcept {
+    write<LogLevel::warning>(nullptr, &site, fmt, std::forward<Args>(args)...);
+  }
+  template <typename... Args>
+  inline static void error(LogFormat<Args...> fmt,
                            Args &&...args) noexcept {
-#ifdef JC_ENABLE_LOGGING
-    auto message = std::format(fmt, std::forward<Args>(args)...);
-    T::error(message);
-#endif
+    write<LogLevel::error>(nullptr, nullptr, fmt, std::forward<Args>(args)...);
   }
   template <typename... Args>
-  inline static void fatal(std::format_string<Args...> fmt,
+  inline static void error(const LogTag &tag,
+                           LogFormat<Args...> fmt,
                            Args &&...args) noexcept {
-#ifdef JC_ENABLE_LOGGING
-    auto message = std::format(fmt, std::forward<Args>(args)...);
-    T::fatal(message);
-#endif
+    write<LogLevel::error>(&tag, nullptr, fmt, std::forward<Args>(args)...);
+  }
+  template <typename... Args>
+  inline static void error(LogSite &site, LogFormat<Args...> fmt,
+                           Args &&...args) noexcept {
+    write<LogLevel::error>(nullptr, &site, fmt, std::forward<Args>(args)...);
+  }
+  template <typename... Args>
+  inline static void fatal(LogFormat<Args...> fmt,
+                           Args &&...args) noexcept {
+    write<LogLevel::fatal>(nullptr, nullptr, fmt, std::forward<Args>(args)...);
+  }
+  template <typename... Args>
+  inline static void fatal(const LogTag &tag,
+                           LogFormat<Args...> fmt,
+                           Args &&...args) noexcept {
+    write<LogLevel::fatal>(&tag, nullptr, fmt, std::forward<Args>(args)...);
+  }
+  template <typename... Args>
+  inline static void fatal(LogSite &site, LogFormat<Args...> fmt,
+                           Args &&...args) noexcept {
+    write<LogLevel::fatal>(nullptr, &site, fmt, std::forward<Args>(args)...);
+  }
+
+  /**
+   * Writes out any messages the Logger is holding on to (see FlushingLogger).
+   * Meant to be called at the end of each frame.
+   */
+  inline static void flush() noexcept {
+    if constexpr (FlushingLogger<T>)
+      T::flush();
+  }
+
+private:
+  template <LogLevel level, typename... Args>
+  inline static void write([[maybe_unused]] const LogTag *tag,
+                           [[maybe_unused]] LogSite *site,
+                           [[maybe_unused]] LogFormat<Args...> fmt,
+                           [[maybe_unused]] Args &&...args) noexcept {
+    if constexpr (log_level_compiled(level)) {
+      if (tag) {
+        if (!tag->enabled(level))
+          return;
+      } else if constexpr (FilteringLogger<T>) {
+        if (!T::enabled(level))
+          return;
+      }
+      if (site && !site->admit())
+        return;
+      if constexpr (DeferringLogger<T> && (Deferrable<Args> && ...)) {
+        // Repeats can only be detected once the message is formatted
+        if (T::can_defer(level) &&
+            !(site && site->get_limit().collapse_repeats)) {
+          auto deferred = DeferredFormat{};
+          if (deferred.capture<Args...>(fmt.format, args...)) {
+            report_suppressed<level>(site, fmt.location);
+            if (T::defer(level, deferred, fmt.location))
+              return;
+          }
+        }
+      }
+      if constexpr (ViewLogger<T>) {
+        // The buffer is skipped if a sink (or formatter) logs while it is in
+        // use, rather than overwriting the outer message
+        auto &buffer = local_buffer();
+        if (!buffer.in_use) {
+          buffer.in_use = true;
+          // Formatting only reads its arguments, so forwarding them here does
+          // not prevent the heap fallback below from using them again
+          auto result = std::format_to_n(buffer.data.data(), buffer_capacity,
+                                         fmt.format,
+                                         std::forward<Args>(args)...);
+          auto size = static_cast<std::size_t>(result.size);
+          if (size <= buffer_capacity)
+            send_from<level>(site,
+                             std::string_view(buffer.data.data(), size),
+                             fmt.location);
+          buffer.in_use = false;
+          if (size <= buffer_capacity)
+            return;
+        }
+      }
+      // Message did not fit in the buffer (or T needs a std::string)
+      auto message = std::format(fmt.format, std::forward<Args>(args)...);
+      send_from<level>(site, message, fmt.location);
+    }
+  }
+
+  // Sends a message, applying the repeat check and summary of its site
+  template <LogLevel level, typename Message>
+  inline static void
+  send_from(LogSite *site, const Message &message,
+            const std::source_location &location) noexcept {
+    if (site && site->repeats(message))
+      return;
+    report_suppressed<level>(site, location);
+    send<level>(message, location);
+  }
+
+  template <LogLevel level>
+  inline static void
+  report_suppressed(LogSite *site,
+                    const std::source_location &location) noexcept {
+    if (!site)
+      return;
+    if (auto count = site->take_suppressed())
+      send<level>(std::format("suppressed {} similar messages", count),
+                  location);
+  }
+
+  template <LogLevel level, typename Message>
+  inline static void send(const Message &message,
+                          const std::source_location &location) noexcept {
+    if constexpr (LocatingLogger<T>) {
+      if constexpr (level == LogLevel::trace)
+        T::trace(message, location);
+      else if constexpr (level == LogLevel::standard)
+        T::standard(message, location);
+      else if constexpr (level == LogLevel::warning)
+        T::warning(message, location);
+      else if constexpr (level == LogLevel::error)
+        T::error(message, location);
+      else
+        T::fatal(message, location);
+    } else if constexpr (level == LogLevel::trace)
+      T::trace(message);
+    else if constexpr (level == LogLevel::standard)
+      T::standard(message);
+    else if constexpr (level == LogLevel::warning)
+      T::warning(message);
+    else if constexpr (level == LogLevel::error)
+      T::error(message);
+    else
+      T::fatal(message);
   }
+
+  struct LocalBuffer {
+    std::array<char, buffer_capacity> data;
+    bool in_use = false;
+  };
+  static LocalBuffer &local_buffer() noexcept {
+    thread_local LocalBuffer buffer;
+    return buffer;
+  }
+};
+
+/**
+ * A typed key-value pair attached to a structured message (see StructuredLog).
+ * Values are kept in binary form, so that sinks can write them out as text,
+ * JSON or any other format without parsing them back out of the message.
+ * @note String keys and values are not copied; log functions may only use
+ * them until they return.
+ */
+class LogField final {
+public:
+  enum class Type : std::uint8_t {
+    boolean,
+    signed_integer,
+    unsigned_integer,
+    floating_point,
+    string
+  };
+
+  constexpr LogField(std::string_view key, bool value) noexcept
+      : field_key(key), field_type(Type::boolean), bool_value(value) {}
+  template <std::signed_integral T>
+  constexpr LogField(std::string_view key, T value) noexcept
+      : field_key(key), field_type(Type::signed_integer), int_value(value) {}
+  template <std::unsigned_integral T>
+    requires(!std::same_as<T, bool>)
+  constexpr LogField(std::string_view key, T value) noexcept
+      : field_key(key), field_type(Type::unsigned_integer), uint_value(value) {}
+  template <std::floating_point T>
+  constexpr LogField(std::string_view key, T value) noexcept
+      : field_key(key), field_type(Type::floating_point), float_value(value) {}
+  constexpr LogField(std::string_view key, std::string_view value) noexcept
+      : field_key(key), field_type(Type::string), string_value(value) {}
+  // Without this, string literals would be converted to bool
+  constexpr LogField(std::string_view key, const char *value) noexcept
+      : LogField(key, std::string_view(value)) {}
+
+  constexpr std::string_view key() const noexcept { return field_key; }
+  constexpr Type type() const noexcept { return field_type; }
+  // Each accessor may only be used for fields of the matching type
+  constexpr bool as_bool() const noexcept { return bool_value; }
+  constexpr std::int64_t as_signed() const noexcept { return int_value; }
+  constexpr std::uint64_t as_unsigned() const noexcept { return uint_value; }
+  constexpr double as_double() const noexcept { return float_value; }
+  constexpr std::string_view as_string() const noexcept {
+    return string_value;
+  }
+
+private:
+  std::string_view field_key;
+  Type field_type;
+  union {
+    bool bool_value;
+    std::int64_t int_value;
+    std::uint64_t uint_value;
+    double float_value;
+    std::string_view string_value;
+  };
+};
+
+/**
+ * A single message, as handed to log functions. Timing and thread information
+ * is captured as raw integers, and only rendered by the sink that writes the
+ * record (see format_log_header()).
+ */
+struct LogRecord {
+  LogLevel level = LogLevel::standard;
+  // Whether timestamp and thread were captured (see LogRecordOptions)
+  bool has_timestamp = false;
+  bool has_thread = false;
+  // Compact index of the sending thread, in the order threads first logged
+  std::uint32_t thread = 0;
+  // Ticks of StandardLogger's clock (see Clock::now_ticks())
+  Clock::duration::rep timestamp = 0;
+  std::string_view message;
+  // Where the message was sent from. Empty (line 0) if the logger was called
+  // directly rather than through LoggerTraits.
+  std::source_location location;
+  // Fields attached through StructuredLog
+  std::span<const LogField> fields;
+  // Set (and message left empty) when the message has not been formatted yet,
+  // which only happens for log functions that accept it (see LogFunctions)
+  const DeferredFormat *deferred = nullptr;
 };
 
+/**
+ * Information that StandardLogger attaches to every record it sends.
+ */
+struct LogRecordOptions {
+  bool timestamps = false;
+  bool thread_ids = false;
+};
+
+// Large enough for any header rendered by format_log_header()
+using LogHeaderBuffer = std::array<char, 48>;
+
+/**
+ * Renders a record's timestamp and thread index, if it has them, like
+ * "[    1.234567] [T3] ".
+ */
+inline std::string_view format_log_header(const LogRecord &record,
+                                          LogHeaderBuffer &buffer) noexcept {
+  auto *out = buffer.data();
+  auto space = [&] {
+    return static_cast<std::ptrdiff_t>(buffer.data() + buffer.size() - out);
+  };
+  if (record.has_timestamp)
+    out = std::format_to_n(out, space(), "[{:12.6f}] ",
+                           Clock::to_seconds(record.timestamp))
+              .out;
+  if (record.has_thread)
+    out = std::format_to_n(out, space(), "[T{}] ", record.thread).out;
+  return std::string_view(buffer.data(), out);
+}
+
+/**
+ * Appends str as a quoted JSON string, escaping it as needed.
+ */
+void append_json_string(std::string_view str, std::string &out) noexcept;
+/**
+ * Appends a record's fields as text, like ` entity=42 name="crate"`.
+ */
+void format_log_fields(const LogRecord &record, std::string &out) noexcept;
+/**
+ * Appends a record as a single line of JSON (without the line break), with
+ * its fields in a nested "fields" object.
+ */
+void format_log_json(const LogRecord &record, std::string &out) noexcept;
+
 /**
  * All functions that can be overwritten for junco's default logger.
  * @note When overwriting log functions, be sure to account for parallel access.
  * Use std::osyncstream or other for thread safety.
  */
 struct LogFunctions {
-  using LogFunction = void (*)(const std::string &);
+  using LogFunction = void (*)(const LogRecord &);
   LogFunction trace;
   LogFunction standard;
   LogFunction warning;
@@ -99,6 +648,68 @@ struct LogFunctions {
   // this is the ONLY function that will be used for logging (all other
   // overwritten functions are ignored).
   LogFunction all;
+  // Whether the functions above accept records that have not been formatted
+  // yet (see LogRecord::deferred), which lets them store arguments as-is
+  bool accepts_deferred = false;
+
+  friend bool operator==(const LogFunctions &,
+                         const LogFunctions &) = default;
+};
+
+/**
+ * One of several destinations a record is sent to at once, registered with
+ * StandardLogger::add_sink().
+ */
+struct LogSink {
+  LogFunctions::LogFunction write;
+  // Levels sent to this sink, with bit n set for the nth LogLevel
+  std::uint8_t levels = log_levels_from(LogLevel::trace);
+  // Whether write accepts records that have not been formatted yet
+  bool accepts_deferred = false;
+
+  friend bool operator==(const LogSink &, const LogSink &) = default;
+};
+
+/**
+ * Decides what the asynchronous backend does when its queue is full.
+ */
+enum class OverflowPolicy : std::uint8_t {
+  block,       // Wait for the writer thread to make room
+  drop_newest, // Discard the message being logged
+  drop_oldest, // Discard the oldest queued message to make room for the new one
+};
+
+/**
+ * Configuration for StandardLogger's asynchronous backend.
+ */
+struct AsyncLogSettings {
+  // Maximum number of queued messages (rounded up to a power of two)
+  std::size_t capacity = 8192;
+  OverflowPolicy overflow = OverflowPolicy::block;
+  // Whether messages handled by the default log functions are formatted on the
+  // writer thread rather than the calling thread (see junco::DeferredFormat)
+  bool deferred_formatting = false;
+};
+
+/**
+ * Configuration for StandardLogger's per-thread line buffers.
+ */
+struct LogBufferSettings {
+  // Bytes a thread buffers before writing them out
+  std::size_t max_bytes = 16 * 1024;
+  // Seconds (of StandardLogger's clock) a message may wait in a buffer. Only
+  // checked when the thread logs again; call Log::flush() at the end of each
+  // frame to write out threads that went quiet.
+  double max_delay = 0.05;
+};
+
+/**
+ * Decoration applied to a message by the default log functions.
+ */
+struct LogStyle {
+  std::string_view prefix;
+  std::string_view suffix;
+  bool use_stderr;
 };
 
 /**
@@ -107,74 +718,442 @@ struct LogFunctions {
  */
 class StandardLogger final {
 public:
-  static void trace(const std::string &msg) noexcept {
-    if (functions.all)
-      functions.all(msg);
-    else if (functions.trace)
-      functions.trace(msg);
-    else
-      default_trace(msg);
+  static void trace(std::string_view msg,
+                    const std::source_location &location = {}) noexcept {
+    write(LogLevel::trace, msg, location);
   }
-  static void standard(const std::string &msg) noexcept {
-    if (functions.all)
-      functions.all(msg);
-    else if (functions.standard)
-      functions.standard(msg);
-    else
-      default_standard(msg);
+  static void standard(std::string_view msg,
+                       const std::source_location &location = {}) noexcept {
+    write(LogLevel::standard, msg, location);
   }
-  static void warning(const std::string &msg) noexcept {
-    if (functions.all)
-      functions.all(msg);
-    else if (functions.warning)
-      functions.warning(msg);
-    else
-      default_warning(msg);
+  static void warning(std::string_view msg,
+                      const std::source_location &location = {}) noexcept {
+    write(LogLevel::warning, msg, location);
   }
-  static void error(const std::string &msg) noexcept {
-    if (functions.all)
-      functions.all(msg);
-    else if (functions.error)
-      functions.error(msg);
-    else
-      default_error(msg);
+  static void error(std::string_view msg,
+                    const std::source_location &location = {}) noexcept {
+    write(LogLevel::error, msg, location);
   }
-  static void fatal(const std::string &msg) noexcept {
-    if (functions.all)
-      functions.all(msg);
-    else if (functions.fatal)
-      functions.fatal(msg);
-    else
-      default_fatal(msg);
+  static void fatal(std::string_view msg,
+                    const std::source_location &location = {}) noexcept {
+    write(LogLevel::fatal, msg, location);
+  }
+
+  /**
+   * Builds a record for a message and sends it through the log function for
+   * its level.
+   */
+  static void write(LogLevel level, std::string_view msg,
+                    const std::source_location &location = {},
+                    std::span<const LogField> fields = {}) noexcept {
+    if (backtrace_enabled.load(std::memory_order_relaxed)) {
+      if (level <= LogLevel::standard)
+        record_backtrace(level, msg);
+      else if (level == LogLevel::fatal)
+        dump_backtrace();
+    }
+    if (emits(level)) {
+      auto record = make_record(level, msg, location);
+      record.fields = fields;
+      dispatch(current_dispatch(), record);
+    }
+  }
+
+  /**
+   * Replaces the log functions. Safe to call while other threads log: each
+   * message is handled entirely by either the old or the new functions.
+   * @note Every distinct configuration of functions and sinks is kept until
+   * the program exits, since other threads may still be using it.
+   */
+  static void set_log_functions(const LogFunctions &new_functions) noexcept;
+
+  /**
+   * Adds a sink. While any sink is registered, each record is formatted once
+   * and handed to every sink whose levels include it, and the log functions
+   * are not used. Like set_log_functions(), safe to call while logging.
+   */
+  static void add_sink(const LogSink &sink) noexcept;
+  /**
+   * Removes every sink that writes through the given function.
+   */
+  static void remove_sink(LogFunctions::LogFunction write) noexcept;
+  /**
+   * Returns a sink writing to the terminal like the default log functions
+   * (including the asynchronous backend and line buffers, when enabled).
+   */
+  static LogSink console_sink(
+      std::uint8_t levels = log_levels_from(LogLevel::trace)) noexcept {
+    return LogSink{.write = default_write, .levels = levels};
+  }
+
+  /**
+   * Chooses what is captured alongside each message. Both are off by default.
+   */
+  static void set_record_options(const LogRecordOptions &options) noexcept {
+    record_options.store(options.timestamps | options.thread_ids << 1,
+                         std::memory_order_relaxed);
+  }
+  static LogRecordOptions get_record_options() noexcept {
+    auto options = record_options.load(std::memory_order_relaxed);
+    return LogRecordOptions{.timestamps = (options & 1u) != 0,
+                            .thread_ids = (options & 2u) != 0};
+  }
+  /**
+   * Sets the clock used to timestamp records, which should be shared with the
+   * rest of the engine so that timestamps can be compared. The clock must
+   * outlive its use by the logger. Passing nullptr restores the default clock,
+   * which starts with the program.
+   */
+  static void set_clock(const Clock *new_clock) noexcept {
+    clock_source.store(new_clock ? new_clock : &default_clock,
+                       std::memory_order_release);
+  }
+  static const Clock &clock() noexcept {
+    return *clock_source.load(std::memory_order_acquire);
+  }
+  /**
+   * Returns the compact index of the calling thread. Threads are numbered in
+   * the order they first ask for their index, starting at 0.
+   */
+  static std::uint32_t thread_index() noexcept {
+    thread_local const auto index =
+        next_thread_index.fetch_add(1, std::memory_order_relaxed);
+    return index;
+  }
+  /**
+   * Builds a record for a message, capturing the information selected by
+   * set_record_options().
+   */
+  static LogRecord
+  make_record(LogLevel level, std::string_view msg,
+              const std::source_location &location = {}) noexcept {
+    auto record =
+        LogRecord{.level = level, .message = msg, .location = location};
+    auto options = record_options.load(std::memory_order_relaxed);
+    if (options & 1u) {
+      record.has_timestamp = true;
+      record.timestamp = clock().now_ticks();
+    }
+    if (options & 2u) {
+      record.has_thread = true;
+      record.thread = thread_index();
+    }
+    return record;
   }
 
-  static void set_log_functions(const LogFunctions &new_functions) noexcept {
-    functions = new_functions;
+  /**
+   * Sets the minimum level of messages that are sent, on top of the compiled
+   * minimum (see JC_LOG_LEVEL). Filtered messages are never formatted.
+   * @note Also applies to every LogTag.
+   */
+  static void set_level(LogLevel minimum) noexcept;
+  static LogLevel get_level() noexcept {
+    return minimum_level.load(std::memory_order_relaxed);
+  }
+  static bool enabled(LogLevel level) noexcept {
+    return (enabled_levels.load(std::memory_order_relaxed) >>
+            static_cast<int>(level)) &
+           1u;
+  }
+
+  /**
+   * Keeps the last `lines` trace and standard messages of each thread in
+   * memory, even if they are below the level set by set_level(). They are
+   * written to stderr when a fatal message is logged, or when the program
+   * receives a fatal signal (SIGSEGV, SIGABRT, ...).
+   * @note Messages must still be compiled in (see JC_LOG_LEVEL) to be
+   * recorded. Threads keep the number of lines set when they first logged.
+   */
+  static void enable_backtrace(std::size_t lines = 64) noexcept;
+  static void disable_backtrace() noexcept;
+  /**
+   * Writes the recorded messages of every thread to a file descriptor
+   * (stderr by default), oldest first.
+   * @note Only uses async-signal-safe calls, so it may be called from a signal
+   * handler.
+   */
+  static void dump_backtrace(int fd = 2) noexcept;
+
+  /**
+   * Moves the default log functions onto a dedicated writer thread. Callers
+   * only push messages into a lock-free queue, which the writer drains and
+   * writes to stdout/stderr in batches.
+   * Returns false if the asynchronous backend is already running.
+   * @note Fatal messages are always written synchronously, after the queue has
+   * been drained, so that they are not lost if the program terminates.
+   */
+  static bool start_async(const AsyncLogSettings &settings = {}) noexcept;
+  /**
+   * Writes all queued messages, then stops the writer thread. Subsequent
+   * messages are written synchronously.
+   */
+  static void stop_async() noexcept;
+  static bool is_async() noexcept {
+    return async_enabled.load(std::memory_order_relaxed);
+  }
+  /**
+   * Returns the number of messages discarded by the overflow policy since the
+   * asynchronous backend was last started.
+   */
+  static std::size_t dropped_messages() noexcept;
+
+  /**
+   * Makes the default log functions collect lines in a buffer per thread,
+   * which is written out in one piece once it holds max_bytes, once its oldest
+   * line is max_delay seconds old, or on flush(). Fatal messages flush every
+   * buffer and are written immediately.
+   * Returns false if buffering is already enabled.
+   * @note Has no effect on messages handled by the asynchronous backend, which
+   * already writes in batches.
+   */
+  static bool start_buffering(const LogBufferSettings &settings = {}) noexcept;
+  /**
+   * Flushes every buffer, and writes subsequent messages immediately.
+   */
+  static void stop_buffering() noexcept;
+  static bool is_buffering() noexcept {
+    return buffering_enabled.load(std::memory_order_relaxed);
+  }
+  /**
+   * Writes out every message sent so far: the line buffers of all threads, and
+   * the queue of the asynchronous backend.
+   */
+  static void flush() noexcept;
+
+  /**
+   * Whether a message can be handed over unformatted: either to the writer
+   * thread, when the default log functions and deferred formatting are in use,
+   * or to log functions that accept deferred records.
+   */
+  static bool can_defer(LogLevel level) noexcept {
+    // Messages recorded by the backtrace must be formatted right away
+    if (level == LogLevel::fatal ||
+        (level <= LogLevel::standard &&
+         backtrace_enabled.load(std::memory_order_relaxed)))
+      return false;
+    const auto &current = current_dispatch();
+    if (!current.sinks.empty())
+      return (current.deferred_levels >> static_cast<int>(level)) & 1u;
+    const auto &functions = current.functions;
+    if (functions.all || function_for(functions, level))
+      return functions.accepts_deferred;
+    return deferred_enabled.load(std::memory_order_relaxed);
+  }
+  /**
+   * Hands an unformatted message to the log function for its level, or to the
+   * writer thread. Returns false if the message must be formatted and written
+   * synchronously instead.
+   */
+  static bool defer(LogLevel level, const DeferredFormat &message,
+                    const std::source_location &location = {}) noexcept;
+
+  /**
+   * Returns the decoration used by the default log functions for a level.
+   */
+  static const LogStyle &style(LogLevel level) noexcept {
+    return active_styles[static_cast<std::size_t>(level)];
+  }
+  /**
+   * Picks colored styles for levels written to a terminal, and plain styles
+   * for levels written to a file or pipe. Called once at startup, so that
+   * logging never checks the terminal itself.
+   * @note Not thread safe; call again (before logging) after redirecting
+   * stdout or stderr.
+   */
+  static void detect_colors() noexcept;
+  /**
+   * Forces colored (or plain) styles for every level.
+   * @note Not thread safe; call before logging.
+   */
+  static void set_colors(bool enabled) noexcept {
+    active_styles = enabled ? color_styles : plain_styles;
   }
 
 private:
-  static void default_trace(const std::string &msg) noexcept {
-    std::osyncstream(std::cout)
-        << "\033[2;3m" << msg << "\033[22;23m" << std::endl;
+  friend class LogTag;
+
+  /**
+   * Everything dispatch() reads. Replaced as a whole, so that each message is
+   * handled by a single configuration.
+   */
+  struct Dispatch {
+    LogFunctions functions;
+    std::vector<LogSink> sinks;
+    // Levels whose sinks all accept deferred records
+    std::uint8_t deferred_levels = 0;
+
+    friend bool operator==(const Dispatch &, const Dispatch &) = default;
+  };
+
+  /**
+   * Publishes a copy of the current configuration, modified by change.
+   */
+  template <typename Change>
+  static void update_dispatch(const Change &change) noexcept;
+  static const Dispatch &current_dispatch() noexcept {
+    return *active_dispatch.load(std::memory_order_acquire);
   }
-  static void default_standard(const std::string &msg) noexcept {
-    std::osyncstream(std::cout) << msg << std::endl;
+  static void dispatch(const Dispatch &current,
+                       const LogRecord &record) noexcept {
+    if (!current.sinks.empty()) {
+      auto level = 1u << static_cast<int>(record.level);
+      for (const auto &sink : current.sinks)
+        if (sink.levels & level)
+          sink.write(record);
+      return;
+    }
+    const auto &functions = current.functions;
+    if (functions.all)
+      functions.all(record);
+    else if (auto function = function_for(functions, record.level))
+      function(record);
+    else
+      default_write(record);
   }
-  static void default_warning(const std::string &msg) noexcept {
-    std::osyncstream(std::cerr)
-        << "\033[33m(warning) " << msg << "\033[39m" << std::endl;
+
+  static void default_write(const LogRecord &record) noexcept {
+    if (async_enabled.load(std::memory_order_acquire) && enqueue_async(record))
+      return;
+    if (buffering_enabled.load(std::memory_order_relaxed) &&
+        buffer_line(record))
+      return;
+    auto header = LogHeaderBuffer{};
+    auto fields = std::string{};
+    format_log_fields(record, fields);
+    const auto &s = style(record.level);
+    std::osyncstream(s.use_stderr ? std::cerr : std::cout)
+        << format_log_header(record, header) << s.prefix << record.message
+        << fields << s.suffix << std::endl;
   }
-  static void default_error(const std::string &msg) noexcept {
-    std::osyncstream(std::cerr)
-        << "\033[31m(error) " << msg << "\033[39m" << std::endl;
+  /**
+   * Hands a message to the writer thread. Returns false if the message must be
+   * written synchronously instead.
+   */
+  static bool enqueue_async(const LogRecord &record) noexcept;
+  /**
+   * Adds a message to the calling thread's line buffer. Returns false if the
+   * message must be written immediately instead.
+   */
+  static bool buffer_line(const LogRecord &record) noexcept;
+
+  /**
+   * Whether messages of a level should be sent, rather than only recorded.
+   */
+  static bool emits(LogLevel level) noexcept {
+    return level >= minimum_level.load(std::memory_order_relaxed);
   }
-  static void default_fatal(const std::string &msg) noexcept {
-    std::osyncstream(std::cerr)
-        << "\033[7;31;1m(fatal)\033[27m " << msg << "\033[39;21m" << std::endl;
+  static void record_backtrace(LogLevel level, std::string_view msg) noexcept;
+
+  static LogFunctions::LogFunction function_for(const LogFunctions &functions,
+                                                LogLevel level) noexcept {
+    switch (level) {
+    case LogLevel::trace:
+      return functions.trace;
+    case LogLevel::standard:
+      return functions.standard;
+    case LogLevel::warning:
+      return functions.warning;
+    case LogLevel::error:
+      return functions.error;
+    default:
+      return functions.fatal;
+    }
   }
 
-  inline static LogFunctions functions{};
+  static constexpr std::array<LogStyle, 5> color_styles{{
+      {"\033[2;3m", "\033[22;23m", false},
+      {"", "", false},
+      {"\033[33m(warning) ", "\033[39m", true},
+      {"\033[31m(error) ", "\033[39m", true},
+      {"\033[7;31;1m(fatal)\033[27m ", "\033[39;21m", true},
+  }};
+  static constexpr std::array<LogStyle, 5> plain_styles{{
+      {"", "", false},
+      {"", "", false},
+      {"(warning) ", "", true},
+      {"(error) ", "", true},
+      {"(fatal) ", "", true},
+  }};
+  // Colored until detect_colors() runs during static initialization
+  inline static std::array<LogStyle, 5> active_styles = color_styles;
+
+  // Snapshot of the functions and sinks in use, replaced as a whole and never
+  // freed, so readers need no locks
+  static const Dispatch default_dispatch;
+  inline static std::atomic<const Dispatch *> active_dispatch{
+      &default_dispatch};
+  inline static std::atomic<bool> async_enabled{false};
+  inline static std::atomic<bool> deferred_enabled{false};
+  inline static std::atomic<bool> backtrace_enabled{false};
+  inline static std::atomic<bool> buffering_enabled{false};
+  inline static std::atomic<LogLevel> minimum_level{LogLevel::trace};
+  // Levels that get past the runtime check, including the ones only recorded
+  // by the backtrace. Tags combine it with their own threshold.
+  inline static std::atomic<std::uint8_t> enabled_levels{
+      log_levels_from(LogLevel::trace)};
+  // Bit 0: timestamps, bit 1: thread ids
+  inline static std::atomic<std::uint8_t> record_options{0};
+  inline static std::atomic<std::uint32_t> next_thread_index{0};
+  inline static const Clock default_clock{};
+  inline static std::atomic<const Clock *> clock_source{&default_clock};
 };
+// Defined outside the class, which must be complete first
+inline const StandardLogger::Dispatch StandardLogger::default_dispatch{};
 
 using Log = LoggerTraits<StandardLogger>;
+
+/**
+ * A message without format arguments, along with the location it was sent
+ * from (see LogFormat).
+ */
+struct LogMessage {
+  template <typename S>
+    requires std::convertible_to<const S &, std::string_view>
+  constexpr LogMessage(const S &text, std::source_location location =
+                                          std::source_location::current())
+      : text(text), location(location) {}
+
+  std::string_view text;
+  std::source_location location;
+};
+
+/**
+ * Structured variant of junco::Log, which sends a fixed message along with
+ * typed fields instead of interpolating values into the text, e.g.
+ *   junco::StructuredLog::warning("slow frame", {{"frame_ms", 16.7}});
+ * Fields are rendered by the log function (see format_log_fields() and
+ * format_log_json()).
+ */
+class StructuredLog final {
+public:
+  using Fields = std::initializer_list<LogField>;
+
+  static void trace(LogMessage msg, Fields fields = {}) noexcept {
+    write<LogLevel::trace>(msg, fields);
+  }
+  static void standard(LogMessage msg, Fields fields = {}) noexcept {
+    write<LogLevel::standard>(msg, fields);
+  }
+  static void warning(LogMessage msg, Fields fields = {}) noexcept {
+    write<LogLevel::warning>(msg, fields);
+  }
+  static void error(LogMessage msg, Fields fields = {}) noexcept {
+    write<LogLevel::error>(msg, fields);
+  }
+  static void fatal(LogMessage msg, Fields fields = {}) noexcept {
+    write<LogLevel::fatal>(msg, fields);
+  }
+
+private:
+  template <LogLevel level>
+  static void write([[maybe_unused]] const LogMessage &msg,
+                    [[maybe_unused]] Fields fields) noexcept {
+    if constexpr (log_level_compiled(level)) {
+      if (StandardLogger::enabled(level))
+        StandardLogger::write(
+            level, msg.text, msg.location,
+            std::span<const LogField>(fields.begin(), fields.size()));
+    }
+  }
+};
 } // namespace junco
\ No newline at end of file
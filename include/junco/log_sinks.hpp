@@ -0,0 +1,161 @@
+/**
+ * @file junco/log_sinks.hpp
+ *
+ * Defines built-in log sinks for junco's default logger. Sinks provide
+ * LogFunctions that can be installed through StandardLogger::set_log_functions
+ * to send messages somewhere other than the terminal.
+ */
+#pragma once
+
+#include "junco/log.hpp" // junco::LogFunctions, junco::LogRecord
+#include <cstddef>       // std::size_t
+#include <filesystem>    // std::filesystem::path
+#include <span>          // std::span
+#include <string>        // std::string
+#include <string_view>   // std::string_view
+
+namespace junco {
+/**
+ * Returns the label written before messages of a level in text log files,
+ * like "(warning) ".
+ */
+std::string_view log_file_label(LogLevel level) noexcept;
+
+/**
+ * How records are written to log files.
+ */
+enum class LogFileFormat {
+  // Header, level label, message and fields, as written to the terminal
+  text,
+  // One JSON object per line (see format_log_json())
+  json_lines
+};
+
+/**
+ * Configuration for MappedFileSink.
+ */
+struct MappedFileSettings {
+  // Size of the mapped file. Once full, the file is rotated.
+  std::size_t capacity = 64 * 1024 * 1024;
+  // Number of rotated files kept alongside the current one (path.1 being the
+  // most recent). If 0, full files are discarded.
+  std::size_t max_files = 4;
+  LogFileFormat format = LogFileFormat::text;
+};
+
+/**
+ * Writes log messages into a pre-sized, memory-mapped file.
+ * Threads reserve space with a single atomic add on a shared write cursor and
+ * copy their message straight into the mapping, so appending a message takes
+ * no locks and no system calls. When the mapping fills up, the file is rotated
+ * and a new one is mapped.
+ * @note Only available on POSIX platforms; open() fails elsewhere.
+ */
+class MappedFileSink final {
+public:
+  /**
+   * Creates (or truncates) the file at path and maps it into memory.
+   * Returns false if the sink is already open or the file could not be mapped.
+   */
+  static bool open(const std::filesystem::path &path,
+                   const MappedFileSettings &settings = {}) noexcept;
+  /**
+   * Unmaps the file, truncating it to the bytes actually written.
+   */
+  static void close() noexcept;
+  static bool is_open() noexcept;
+
+  static void write(const LogRecord &record) noexcept;
+  /**
+   * Returns log functions which send every channel to this sink.
+   */
+  static LogFunctions functions() noexcept {
+    return LogFunctions{.trace = nullptr,
+                        .standard = nullptr,
+                        .warning = nullptr,
+                        .error = nullptr,
+                        .fatal = nullptr,
+                        .all = write};
+  }
+
+private:
+  // Copies the concatenation of parts into the file, rotating it if needed
+  static void append(std::span<const std::string_view> parts) noexcept;
+};
+
+/**
+ * Streams records to another process (a log viewer or aggregator) through a
+ * Unix domain datagram socket, one record per datagram.
+ * Sends never block: when the receiver falls behind, is not running, or a
+ * record is larger than a datagram can be, the record is dropped and counted
+ * instead. Since the receiver is addressed by path on every send, it can be
+ * started, stopped and restarted while the sink is open.
+ * @note Only available on POSIX platforms; open() fails elsewhere.
+ */
+class SocketSink final {
+public:
+  /**
+   * Creates the sending socket for a receiver bound at path (which does not
+   * need to exist yet). Returns false if the sink is already open, the path is
+   * too long for a socket address, or the socket could not be created.
+   */
+  static bool open(const std::filesystem::path &path,
+                   LogFileFormat format = LogFileFormat::text) noexcept;
+  static void close() noexcept;
+  static bool is_open() noexcept;
+  /**
+   * Returns the number of records dropped since the sink was opened.
+   */
+  static std::size_t dropped_records() noexcept;
+
+  static void write(const LogRecord &record) noexcept;
+  /**
+   * Returns log functions which send every channel to this sink.
+   */
+  static LogFunctions functions() noexcept {
+    return LogFunctions{.trace = nullptr,
+                        .standard = nullptr,
+                        .warning = nullptr,
+                        .error = nullptr,
+                        .fatal = nullptr,
+                        .all = write};
+  }
+
+private:
+  // Sends the concatenation of parts as a single datagram
+  static void send(std::span<const std::string_view> parts) noexcept;
+};
+
+/**
+ * The receiving end of a SocketSink: binds a datagram socket at a path and
+ * returns the records sent to it. Used by the junco_logreceive tool.
+ * @note Only available on POSIX platforms; is_open() is false elsewhere.
+ */
+class LogSocketReceiver final {
+public:
+  // Largest record returned by receive(); longer records are cut short
+  static constexpr std::size_t max_record_size = 64 * 1024;
+
+  /**
+   * Binds a socket at path, replacing any socket file left there.
+   */
+  explicit LogSocketReceiver(const std::filesystem::path &path) noexcept;
+  /**
+   * Closes the socket and removes its file.
+   */
+  ~LogSocketReceiver();
+  LogSocketReceiver(const LogSocketReceiver &) = delete;
+  LogSocketReceiver &operator=(const LogSocketReceiver &) = delete;
+
+  bool is_open() const noexcept { return fd >= 0; }
+  /**
+   * Waits up to timeout seconds for a record and stores it in record.
+   * Returns false if none arrived in time, or the socket is not open.
+   */
+  bool receive(std::string &record, double timeout) noexcept;
+
+private:
+  std::filesystem::path path;
+  int fd = -1;
+};
+} // namespace junco
\ No newline at end of file
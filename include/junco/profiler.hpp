@@ -0,0 +1,154 @@
+/**
+ * @file junco/profiler.hpp
+ *
+ * A hierarchical scoped profiler. Zones are marked with JC_PROFILE_SCOPE (or
+ * a junco::ProfileScope), which records when the enclosing scope is entered
+ * and left. Each thread writes its zones to its own lock-free buffer, so
+ * recording a zone never blocks or allocates.
+ *
+ * Once per frame, Profiler::end_frame() collects the zones recorded by every
+ * thread into a tree, with the total time spent in and the number of calls to
+ * each zone, nested under the zones which were open when it was entered.
+ *
+ * Frames can also be captured with ProfileTrace, which streams every zone to a
+ * file that Perfetto or chrome://tracing can open.
+ *
+ * JC_PROFILE_SCOPE expands to nothing unless JC_ENABLE_PROFILING is defined
+ * (see docs/building.md).
+ */
+
+#pragma once
+#include "junco/time.hpp" // junco::TscClock
+#include <cstddef>        // std::size_t
+#include <cstdint>        // std::uint32_t, std::uint64_t
+#include <filesystem>     // std::filesystem::path
+#include <string>         // std::string
+#include <vector>         // std::vector
+
+// Profiling macros. Zones only cost anything when JC_ENABLE_PROFILING is
+// defined; otherwise, the macros are removed by the preprocessor.
+#define JC_PROFILE_CONCAT_IMPL(a, b) a##b
+#define JC_PROFILE_CONCAT(a, b) JC_PROFILE_CONCAT_IMPL(a, b)
+#if defined(JC_ENABLE_PROFILING)
+#define JC_PROFILE_SCOPE(name)                                                 \
+  const ::junco::ProfileScope JC_PROFILE_CONCAT(jc_profile_scope_,           \
+                                                __LINE__)(name)
+#else
+#define JC_PROFILE_SCOPE(name) ((void)0)
+#endif
+
+namespace junco {
+/**
+ * A zone of a frame's profile tree, which aggregates every call to the zone
+ * made from the same parent zone, on the same thread.
+ */
+struct ProfileNode {
+  static constexpr std::uint32_t no_parent = UINT32_MAX;
+
+  // The name given to the zone, as passed to ProfileScope
+  const char *name;
+  // Index of the enclosing zone in ProfileFrame::nodes, or no_parent
+  std::uint32_t parent;
+  // Number of enclosing zones
+  std::uint32_t depth;
+  // Index of the recording thread, in the order threads first recorded zones
+  std::uint32_t thread;
+  // Number of calls which ended during the frame
+  std::uint32_t calls;
+  // Total time spent in those calls, including nested zones
+  TscClock::duration total;
+};
+
+/**
+ * The zones recorded during a frame.
+ */
+struct ProfileFrame {
+  // Number of frames ended before this one
+  std::uint64_t number = 0;
+  TscClock::time_point start;
+  TscClock::time_point end;
+  // Every zone of the frame, in depth-first order: each zone is followed by
+  // the zones nested in it, in the order they were first entered. Zones are
+  // grouped by thread.
+  std::vector<ProfileNode> nodes;
+  // Zones which could not be recorded because a thread's buffer was full
+  std::size_t dropped_zones = 0;
+
+  TscClock::duration get_duration() const noexcept { return end - start; }
+};
+
+/**
+ * Collects the zones recorded by every thread.
+ * @note Zones are attributed to the frame during which they end. Zones that
+ * are still open when a frame ends appear in the next frame, with the same
+ * ancestors.
+ */
+class Profiler final {
+public:
+  // Events stored per thread between two calls to end_frame(). Each zone
+  // takes two events; zones entered once a buffer is full are dropped.
+  static constexpr std::size_t buffer_capacity = 16 * 1024;
+
+  /**
+   * Records that the calling thread entered the zone called name, which must
+   * outlive the profiler (usually a string literal).
+   */
+  static void begin_zone(const char *name) noexcept;
+  /**
+   * Records that the calling thread left the zone it entered last.
+   */
+  static void end_zone() noexcept;
+  /**
+   * Collects the zones recorded since the previous call, and returns them.
+   * The frame stays valid until end_frame() is called again.
+   */
+  static const ProfileFrame &end_frame() noexcept;
+};
+
+/**
+ * Records a zone from its construction to its destruction.
+ */
+class ProfileScope final {
+public:
+  explicit ProfileScope(const char *name) noexcept {
+    Profiler::begin_zone(name);
+  }
+  ~ProfileScope() { Profiler::end_zone(); }
+  ProfileScope(const ProfileScope &) = delete;
+  ProfileScope &operator=(const ProfileScope &) = delete;
+};
+
+/**
+ * Captures the zones collected by Profiler::end_frame() in the Chrome Trace
+ * Event format (JSON), which Perfetto (ui.perfetto.dev) and chrome://tracing
+ * can open. Each zone call is written as a complete event, on the track of its
+ * thread, and the end of each frame as a global instant event named after its
+ * number.
+ * Zones are formatted and written by a background thread, so a capture does
+ * not need to fit in memory.
+ */
+class ProfileTrace final {
+public:
+  /**
+   * Creates (or truncates) the file at path, and writes every zone collected
+   * from the next call to Profiler::end_frame() on.
+   * Returns false if a capture is already running or the file could not be
+   * created.
+   */
+  static bool start(const std::filesystem::path &path) noexcept;
+  /**
+   * Writes the zones collected so far and closes the file.
+   * @note Zones that end after the last call to Profiler::end_frame() are not
+   * written.
+   */
+  static void stop() noexcept;
+  static bool is_capturing() noexcept;
+};
+
+/**
+ * Appends the zones of frame to out as an indented tree, one zone per line,
+ * with their total time in milliseconds and call count.
+ */
+void format_profile_frame(const ProfileFrame &frame,
+                          std::string &out) noexcept;
+} // namespace junco
\ No newline at end of file
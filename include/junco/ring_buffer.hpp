@@ -0,0 +1,119 @@
+/**
+ * @file junco/ring_buffer.hpp
+ *
+ * Defines a bounded, lock-free ring buffer that can be shared by any number of
+ * producer and consumer threads.
+ *
+ * The ring buffer is used by the engine wherever hot threads need to hand work
+ * off to a background thread without ever taking a lock (for instance, the
+ * asynchronous logging backend).
+ */
+#pragma once
+
+#include <atomic>      // std::atomic
+#include <bit>         // std::bit_ceil
+#include <cstddef>     // std::size_t
+#include <memory>      // std::unique_ptr
+#include <type_traits> // std::is_nothrow_move_assignable_v
+#include <utility>     // std::move
+
+namespace junco {
+
+/**
+ * Bounded multi-producer, multi-consumer queue.
+ * Each slot carries a sequence number that tells producers and consumers
+ * whether it is free to write or ready to read, so neither side ever blocks
+ * the other.
+ * @note Capacity is rounded up to the nearest power of two.
+ */
+template <typename T>
+  requires std::is_default_constructible_v<T> &&
+           std::is_nothrow_move_assignable_v<T>
+class RingBuffer final {
+public:
+  explicit RingBuffer(std::size_t capacity)
+      : mask(std::bit_ceil(capacity < 2 ? std::size_t{2} : capacity) - 1),
+        slots(std::make_unique<Slot[]>(mask + 1)) {
+    for (std::size_t i = 0; i <= mask; ++i)
+      slots[i].sequence.store(i, std::memory_order_relaxed);
+  }
+  RingBuffer(const RingBuffer &) = delete;
+  void operator=(const RingBuffer &) = delete;
+
+  /**
+   * Attempts to move a value into the buffer.
+   * Returns false (leaving value untouched) if the buffer is full.
+   */
+  bool try_push(T &&value) noexcept {
+    auto pos = head.load(std::memory_order_relaxed);
+    for (;;) {
+      auto &slot = slots[pos & mask];
+      auto seq = slot.sequence.load(std::memory_order_acquire);
+      auto diff = static_cast<std::ptrdiff_t>(seq - pos);
+      if (diff == 0) {
+        if (head.compare_exchange_weak(pos, pos + 1,
+                                       std::memory_order_relaxed)) {
+          slot.value = std::move(value);
+          slot.sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = head.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /**
+   * Attempts to move the oldest value out of the buffer.
+   * Returns false if the buffer is empty.
+   */
+  bool try_pop(T &out) noexcept {
+    auto pos = tail.load(std::memory_order_relaxed);
+    for (;;) {
+      auto &slot = slots[pos & mask];
+      auto seq = slot.sequence.load(std::memory_order_acquire);
+      auto diff = static_cast<std::ptrdiff_t>(seq - (pos + 1));
+      if (diff == 0) {
+        if (tail.compare_exchange_weak(pos, pos + 1,
+                                       std::memory_order_relaxed)) {
+          out = std::move(slot.value);
+          slot.sequence.store(pos + mask + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = tail.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  std::size_t capacity() const noexcept { return mask + 1; }
+  /**
+   * Returns the number of values in the buffer.
+   * @note Only a snapshot; other threads may change it immediately after.
+   */
+  std::size_t size() const noexcept {
+    auto h = head.load(std::memory_order_acquire);
+    auto t = tail.load(std::memory_order_acquire);
+    return h > t ? h - t : 0;
+  }
+  bool empty() const noexcept { return size() == 0; }
+
+private:
+  // Keeps producers and consumers from sharing a cache line
+  static constexpr std::size_t cache_line = 64;
+
+  struct Slot {
+    std::atomic<std::size_t> sequence;
+    T value;
+  };
+
+  const std::size_t mask;
+  std::unique_ptr<Slot[]> slots;
+  alignas(cache_line) std::atomic<std::size_t> head{0};
+  alignas(cache_line) std::atomic<std::size_t> tail{0};
+};
+} // namespace junco
\ No newline at end of file
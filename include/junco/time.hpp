@@ -6,10 +6,29 @@
  *
  * They are used by the engine to calculate delta time and to create
  * stopwatches, which are used for profiling.
+ *
+ * Clocks can be built over any std::chrono-compatible clock. junco::Clock
+ * uses std::chrono::high_resolution_clock, junco::TscClock reads the CPU's
+ * timestamp counter, and junco::ManualClock only moves when advanced by hand,
+ * for tests and deterministic replays.
  */
 
 #pragma once
-#include <chrono> // std::chrono
+#include <atomic>  // std::atomic
+#include <chrono>  // std::chrono
+#include <cstdint> // std::int64_t, std::uint32_t
+#include <ratio>   // std::nano
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define JC_HAS_TSC
+#if defined(_MSC_VER)
+#include <intrin.h> // __rdtsc
+#else
+#include <x86intrin.h> // __rdtsc
+#endif
+#elif defined(__aarch64__) && (defined(__GNUC__) || defined(__clang__))
+#define JC_HAS_TSC
+#endif
 
 namespace junco {
 
@@ -43,57 +62,269 @@ struct Date {
 };
 
 /**
- * Object that provides a uniform interface for measuring elapsed time and
- * retrieving local time/date information.
+ * Converts UTC time points to local time.
+ * The system's time zone is looked up once, and the offset of local time from
+ * UTC is cached along with the period it is valid for, so that the time zone
+ * database is only consulted when that period ends (like at a daylight saving
+ * transition).
  */
-class Clock final {
+class LocalTimeZone final {
 public:
-  Clock() noexcept;
+  LocalTimeZone() noexcept;
+  // Copies share the zone, and start with an empty offset cache
+  LocalTimeZone(const LocalTimeZone &other) noexcept;
+  LocalTimeZone &operator=(const LocalTimeZone &other) noexcept;
 
+  Time get_time(std::chrono::system_clock::time_point utc) const noexcept;
+  Date get_date(std::chrono::system_clock::time_point utc) const noexcept;
   /**
-   * Returns the time, in seconds, since the clock was created.
+   * Looks up the system's time zone again, after it changed.
+   */
+  void refresh() noexcept;
+
+private:
+  using local_time_point =
+      std::chrono::local_time<std::chrono::system_clock::duration>;
+
+  local_time_point
+  to_local(std::chrono::system_clock::time_point utc) const noexcept;
+  std::chrono::seconds
+  utc_offset(std::chrono::system_clock::time_point utc) const noexcept;
+  // Empties the cached offset's period, so that it is looked up again
+  void clear_offset() noexcept;
+
+  // Null if the system's time zone could not be found, in which case local
+  // time is UTC
+  std::atomic<const std::chrono::time_zone *> zone;
+
+  // Cached UTC offset, valid from offset_begin until offset_end (in seconds
+  // since the epoch). Guarded by a sequence lock: offset_version is odd while
+  // the cache is being written, and readers retry if it changed under them.
+  mutable std::atomic<std::uint32_t> offset_version{0};
+  mutable std::atomic<std::int64_t> offset_begin{0};
+  mutable std::atomic<std::int64_t> offset_end{0};
+  mutable std::atomic<std::int64_t> offset_seconds{0};
+};
+
+/**
+ * A std::chrono-compatible clock that only moves when advanced. Its time is
+ * shared by every user, starts at 0 and never goes backwards.
+ */
+struct ManualClock {
+  using rep = std::int64_t;
+  using period = std::nano;
+  using duration = std::chrono::duration<rep, period>;
+  using time_point = std::chrono::time_point<ManualClock>;
+  static constexpr bool is_steady = true;
+
+  static time_point now() noexcept {
+    return time_point(duration(ticks.load(std::memory_order_acquire)));
+  }
+  /**
+   * Moves the clock forward. Negative amounts are ignored.
    */
-  double get_time() const noexcept;
+  static void advance(duration amount) noexcept {
+    if (amount.count() > 0)
+      ticks.fetch_add(amount.count(), std::memory_order_acq_rel);
+  }
 
-  Time get_local_time() const noexcept;
-  Date get_local_date() const noexcept;
+private:
+  inline static std::atomic<rep> ticks{0};
+};
+
+/**
+ * A std::chrono-compatible clock that reads the CPU's timestamp counter
+ * (rdtsc on x86-64, cntvct_el0 on ARM64), which is much cheaper than going
+ * through the operating system.
+ * The counter is calibrated against std::chrono::steady_clock the first time
+ * this clock is used, which takes a few milliseconds, and time points share
+ * steady_clock's epoch. Where the counter is missing or not known to tick at a
+ * constant rate, steady_clock is read instead.
+ * @note Conversions go through a double, so nanoseconds stay exact for about
+ * 100 days of counter ticks.
+ */
+struct TscClock {
+  using rep = std::int64_t;
+  using period = std::nano;
+  using duration = std::chrono::duration<rep, period>;
+  using time_point = std::chrono::time_point<TscClock>;
+  static constexpr bool is_steady = true;
+
+  static time_point now() noexcept {
+    const auto &counter = calibration();
+    if (counter.nanoseconds_per_tick == 0)
+      return time_point(std::chrono::duration_cast<duration>(
+          std::chrono::steady_clock::now().time_since_epoch()));
+    // Signed, so that a read slightly before base_ticks (on another core, or
+    // after a migration) gives a small negative offset instead of wrapping
+    auto ticks = static_cast<double>(
+        static_cast<std::int64_t>(read_counter() - counter.base_ticks));
+    return time_point(duration(
+        counter.base_nanoseconds +
+        static_cast<rep>(ticks * counter.nanoseconds_per_tick)));
+  }
+  /**
+   * Whether the timestamp counter is read, rather than steady_clock.
+   */
+  static bool uses_counter() noexcept {
+    return calibration().nanoseconds_per_tick != 0;
+  }
 
 private:
-  using chrono_clock = std::chrono::high_resolution_clock;
+  struct Calibration {
+    // Counter value at steady_clock time base_nanoseconds
+    std::uint64_t base_ticks;
+    rep base_nanoseconds;
+    // 0 if the counter cannot be used
+    double nanoseconds_per_tick;
+  };
+
+  static const Calibration &calibration() noexcept {
+    static const auto result = calibrate();
+    return result;
+  }
+  static Calibration calibrate() noexcept;
+
+  static std::uint64_t read_counter() noexcept {
+#if defined(__x86_64__) || defined(_M_X64)
+    return __rdtsc();
+#elif defined(JC_HAS_TSC)
+    std::uint64_t ticks;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    return 0;
+#endif
+  }
+};
+
+/**
+ * Object that provides a uniform interface for measuring elapsed time and
+ * retrieving local time/date information, over a std::chrono-compatible
+ * clock.
+ */
+template <typename ChronoClock> class BasicClock final {
+public:
+  using duration = typename ChronoClock::duration;
+
+  BasicClock() noexcept
+      : start_time(ChronoClock::now()),
+        system_start(std::chrono::system_clock::now()) {}
+
+  /**
+   * Returns the time, in seconds, since the clock was created.
+   */
+  double get_time() const noexcept { return to_seconds(now_ticks()); }
+  /**
+   * Returns the raw number of ticks since the clock was created. Cheaper than
+   * get_time(), since it skips the conversion to seconds, and exact: prefer
+   * it for measurements that are stored or added up, and convert to seconds
+   * only for display.
+   */
+  typename duration::rep now_ticks() const noexcept {
+    return (ChronoClock::now() - start_time).count();
+  }
+  /**
+   * Returns the time since the clock was created, as a typed duration.
+   */
+  duration get_elapsed() const noexcept { return duration(now_ticks()); }
+  /**
+   * Converts ticks returned by now_ticks() to seconds.
+   */
+  static constexpr double to_seconds(typename duration::rep ticks) noexcept {
+    return std::chrono::duration<double>(duration(ticks)).count();
+  }
 
-  auto get_local_raw() const noexcept {
-    auto utc_now = std::chrono::system_clock::now();
-    auto local_now = std::chrono::current_zone()->to_local(utc_now);
-    return local_now;
+  Time get_local_time() const noexcept {
+    return time_zone.get_time(std::chrono::system_clock::now());
+  }
+  Date get_local_date() const noexcept {
+    return time_zone.get_date(std::chrono::system_clock::now());
+  }
+  /**
+   * Returns the local time at which now_ticks() returned ticks, without
+   * reading the system clock again. Cheap enough to call for every log line.
+   * For clocks that do not follow real time, like ManualClock, this is the
+   * local time at which the clock was created, plus the ticks.
+   */
+  Time get_local_time(typename duration::rep ticks) const noexcept {
+    using system_duration = std::chrono::system_clock::duration;
+    return time_zone.get_time(
+        system_start +
+        std::chrono::duration_cast<system_duration>(duration(ticks)));
   }
 
-  chrono_clock::time_point start_time;
+  /**
+   * Looks up the system's time zone again. The zone is otherwise only looked
+   * up when the clock is created, so call this after it changes.
+   */
+  void refresh_time_zone() noexcept { time_zone.refresh(); }
+
+private:
+  typename ChronoClock::time_point start_time;
+  // The system clock at the time start_time was taken
+  std::chrono::system_clock::time_point system_start;
+  LocalTimeZone time_zone;
 };
 
 /**
  * Provides utilities for measuring time elapsed between two points.
  */
-class Stopwatch final {
+template <typename ChronoClock> class BasicStopwatch final {
 public:
-  Stopwatch(const Clock &) noexcept;
-  Stopwatch(const Stopwatch &other) noexcept;
-  ~Stopwatch() = default;
+  using duration = typename BasicClock<ChronoClock>::duration;
 
-  void operator=(const Stopwatch &) = delete;
+  BasicStopwatch(const BasicClock<ChronoClock> &clock) noexcept
+      : clock(clock), start_ticks(0), is_started(false) {}
+  BasicStopwatch(const BasicStopwatch &other) noexcept
+      : clock(other.clock), start_ticks(0), is_started(false) {}
+  ~BasicStopwatch() = default;
 
-  void start() noexcept;
-  double get_time() noexcept;
+  void operator=(const BasicStopwatch &) = delete;
+
+  void start() noexcept {
+    is_started = true;
+    start_ticks = clock.now_ticks();
+  }
+  /**
+   * Returns the seconds since the stopwatch was started, or 0 if it is not
+   * running.
+   */
+  double get_time() const noexcept {
+    return BasicClock<ChronoClock>::to_seconds(get_ticks());
+  }
+  /**
+   * Returns the clock ticks since the stopwatch was started, or 0 if it is
+   * not running.
+   */
+  typename duration::rep get_ticks() const noexcept {
+    return is_started ? clock.now_ticks() - start_ticks : 0;
+  }
+  duration get_elapsed() const noexcept { return duration(get_ticks()); }
   /**
    * Stops the stopwatch, returning the time before it was stopped.
    * Subsequent calls to get_time() will return 0.
    */
-  double stop() noexcept;
+  double stop() noexcept {
+    return BasicClock<ChronoClock>::to_seconds(stop_ticks());
+  }
+  /**
+   * Like stop(), but returns clock ticks.
+   */
+  typename duration::rep stop_ticks() noexcept {
+    auto ticks = get_ticks();
+    is_started = false;
+    return ticks;
+  }
 
-  bool started() const noexcept;
+  bool started() const noexcept { return is_started; }
 
 private:
-  const Clock &clock;
-  double start_time;
+  const BasicClock<ChronoClock> &clock;
+  typename duration::rep start_ticks;
   bool is_started;
 };
+
+using Clock = BasicClock<std::chrono::high_resolution_clock>;
+using Stopwatch = BasicStopwatch<std::chrono::high_resolution_clock>;
 } // namespace junco
\ No newline at end of file
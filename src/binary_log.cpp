@@ -0,0 +1,747 @@
+#include "junco/binary_log.hpp"
+#include "junco/compression.hpp"
+#include "junco/log_sinks.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <istream>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <ostream>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace junco {
+namespace {
+constexpr std::string_view magic = "JCBLOG";
+constexpr std::uint8_t version = 3;
+constexpr std::uint32_t byte_order_mark = 0x01020304;
+constexpr std::uint8_t timestamp_flag = 1;
+constexpr std::uint8_t thread_flag = 2;
+constexpr std::uint8_t fields_flag = 4;
+// Buffered records are written once they reach this size
+constexpr std::size_t flush_size = 64 * 1024;
+// Sealed blocks waiting for the compression thread. Loggers wait for it to
+// catch up beyond this.
+constexpr std::size_t max_queued_blocks = 8;
+
+template <typename T> void put(std::string &out, T value) noexcept {
+  auto bytes = std::array<char, sizeof(T)>{};
+  std::memcpy(bytes.data(), &value, sizeof(T));
+  out.append(bytes.data(), bytes.size());
+}
+
+template <typename T> bool get(std::istream &in, T &value) noexcept {
+  return static_cast<bool>(
+      in.read(reinterpret_cast<char *>(&value), sizeof(T)));
+}
+
+// Appends the length (u32) and bytes of text
+void put_text(std::string &out, std::string_view text) noexcept {
+  put(out, static_cast<std::uint32_t>(text.size()));
+  out.append(text);
+}
+
+bool get_text(std::istream &in, std::string &text) noexcept {
+  std::uint32_t size;
+  if (!get(in, size))
+    return false;
+  text.resize(size);
+  return static_cast<bool>(in.read(text.data(), size));
+}
+
+/**
+ * Appends the fields of a structured record, keeping their types.
+ */
+void put_fields(std::string &out, std::span<const LogField> fields) noexcept {
+  put(out, static_cast<std::uint32_t>(fields.size()));
+  for (const auto &field : fields) {
+    put_text(out, field.key());
+    put(out, static_cast<std::uint8_t>(field.type()));
+    switch (field.type()) {
+    case LogField::Type::boolean:
+      put(out, static_cast<std::uint8_t>(field.as_bool()));
+      break;
+    case LogField::Type::signed_integer:
+      put(out, field.as_signed());
+      break;
+    case LogField::Type::unsigned_integer:
+      put(out, field.as_unsigned());
+      break;
+    case LogField::Type::floating_point:
+      put(out, field.as_double());
+      break;
+    case LogField::Type::string:
+      put_text(out, field.as_string());
+      break;
+    }
+  }
+}
+
+/**
+ * Returns whether a replacement field of format nests another, as dynamic
+ * widths and precisions do ("{:{}}"), which format_decoded() cannot render.
+ */
+bool has_nested_fields(std::string_view format) noexcept {
+  for (std::size_t i = 0; i < format.size(); ++i) {
+    if (format[i] != '{')
+      continue;
+    if (i + 1 < format.size() && format[i + 1] == '{') {
+      ++i;
+      continue;
+    }
+    i = format.find_first_of("{}", i + 1);
+    if (i == std::string_view::npos)
+      return false;
+    if (format[i] == '{')
+      return true;
+  }
+  return false;
+}
+
+/**
+ * Identifies a format string by its address and argument types, which are
+ * cheaper to compare than its text.
+ */
+struct FormatKey {
+  const char *data;
+  std::size_t size;
+  std::array<DeferredType, DeferredFormat::max_arguments> types{};
+
+  explicit FormatKey(const DeferredFormat &deferred) noexcept
+      : data(deferred.get_format().data()),
+        size(deferred.get_format().size()) {
+    std::ranges::copy(deferred.types(), types.begin());
+  }
+  bool operator==(const FormatKey &) const noexcept = default;
+};
+
+struct FormatKeyHash {
+  std::size_t operator()(const FormatKey &key) const noexcept {
+    auto hash = std::hash<const char *>()(key.data) ^ key.size;
+    for (auto type : key.types)
+      hash = hash * 31 + static_cast<std::size_t>(type);
+    return hash;
+  }
+};
+
+/**
+ * Records sealed into a block, along with the formats they introduced.
+ */
+struct Block {
+  std::string formats;
+  std::string records;
+  std::int64_t earliest;
+  std::int64_t latest;
+};
+
+/**
+ * Compresses sealed blocks and writes them out, on its own thread. Only this
+ * thread writes to the file while it runs.
+ */
+struct BlockWriter {
+  std::mutex mutex;
+  std::condition_variable changed;
+  std::deque<Block> queue;
+  // Strings of written blocks, reused for the next ones
+  std::vector<std::string> spare;
+  bool running = false;
+  std::thread thread;
+
+  void run(std::ofstream &file) noexcept {
+    auto compressed = std::string();
+    auto lock = std::unique_lock(mutex);
+    for (;;) {
+      changed.wait(lock, [this] { return !queue.empty() || !running; });
+      if (queue.empty())
+        return;
+      auto block = std::move(queue.front());
+      queue.pop_front();
+      lock.unlock();
+
+      compressed.clear();
+      compress_block(block.records, compressed);
+      auto header = std::string(block.formats);
+      header.push_back('B');
+      put(header, block.earliest);
+      put(header, block.latest);
+      put(header, static_cast<std::uint32_t>(block.records.size()));
+      put(header, static_cast<std::uint32_t>(compressed.size()));
+      file.write(header.data(), static_cast<std::streamsize>(header.size()));
+      file.write(compressed.data(),
+                 static_cast<std::streamsize>(compressed.size()));
+
+      lock.lock();
+      for (auto *text : {&block.formats, &block.records}) {
+        text->clear();
+        spare.push_back(std::move(*text));
+      }
+      changed.notify_all();
+    }
+  }
+};
+
+struct BinaryLogState {
+  std::mutex mutex;
+  std::ofstream file;
+  BinaryLogSettings settings;
+  std::string buffer;
+  std::unordered_map<FormatKey, std::uint32_t, FormatKeyHash> format_ids;
+  // When compressing, formats introduced by the buffered records, and the
+  // range of their timestamps
+  std::string formats;
+  std::int64_t earliest = std::numeric_limits<std::int64_t>::max();
+  std::int64_t latest = std::numeric_limits<std::int64_t>::min();
+  BlockWriter writer;
+
+  void flush() noexcept {
+    file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    buffer.clear();
+  }
+
+  /**
+   * Hands the buffered records to the writer thread as a block, waiting if it
+   * has fallen too far behind.
+   */
+  void seal_block() noexcept {
+    if (buffer.empty())
+      return;
+    auto block = Block{.earliest = earliest, .latest = latest};
+    std::swap(block.formats, formats);
+    std::swap(block.records, buffer);
+    earliest = std::numeric_limits<std::int64_t>::max();
+    latest = std::numeric_limits<std::int64_t>::min();
+    auto lock = std::unique_lock(writer.mutex);
+    writer.changed.wait(
+        lock, [this] { return writer.queue.size() < max_queued_blocks; });
+    writer.queue.push_back(std::move(block));
+    for (auto *text : {&buffer, &formats}) {
+      if (!writer.spare.empty()) {
+        *text = std::move(writer.spare.back());
+        writer.spare.pop_back();
+      }
+    }
+    writer.changed.notify_all();
+  }
+
+  // Returns the id of a capture's format string, writing it to the table the
+  // first time it is seen, or 0 if the decoder could not render it
+  std::uint32_t format_id(const DeferredFormat &deferred) noexcept {
+    auto format = deferred.get_format();
+    auto types = deferred.types();
+    auto [it, inserted] = format_ids.try_emplace(FormatKey(deferred), 0);
+    if (inserted && !has_nested_fields(format)) {
+      it->second = static_cast<std::uint32_t>(format_ids.size());
+      // Formats stay outside of compressed blocks
+      auto &out = settings.compress ? formats : buffer;
+      out.push_back('F');
+      put(out, it->second);
+      put(out, static_cast<std::uint8_t>(types.size()));
+      for (auto type : types)
+        put(out, static_cast<std::uint8_t>(type));
+      put(out, static_cast<std::uint32_t>(format.size()));
+      out.append(format);
+    }
+    return it->second;
+  }
+};
+BinaryLogState &binary_log() noexcept {
+  static BinaryLogState state;
+  return state;
+}
+
+/**
+ * Closes the sink during static destruction if the user did not, so that
+ * buffered records are written and the compression thread is stopped.
+ */
+struct BinaryLogShutdown {
+  ~BinaryLogShutdown() { BinaryLogSink::close(); }
+};
+
+bool decodable(const DeferredFormat &deferred) noexcept {
+  return std::ranges::none_of(deferred.types(), [](DeferredType type) {
+    return type == DeferredType::other;
+  });
+}
+
+struct StoredFormat {
+  std::string text;
+  std::vector<DeferredType> types;
+};
+
+/**
+ * A field read back from a record. Its text is kept here, so that LogFields
+ * can refer to it.
+ */
+struct StoredField {
+  std::string key;
+  LogField::Type type;
+  std::uint64_t value;
+  std::string text;
+
+  bool read(std::istream &in) noexcept {
+    std::uint8_t stored_type;
+    if (!get_text(in, key) || !get(in, stored_type))
+      return false;
+    type = static_cast<LogField::Type>(stored_type);
+    switch (type) {
+    case LogField::Type::boolean: {
+      std::uint8_t flag;
+      if (!get(in, flag))
+        return false;
+      value = flag;
+      return true;
+    }
+    case LogField::Type::signed_integer:
+    case LogField::Type::unsigned_integer:
+    case LogField::Type::floating_point:
+      return get(in, value);
+    case LogField::Type::string:
+      return get_text(in, text);
+    }
+    return false;
+  }
+
+  LogField field() const noexcept {
+    switch (type) {
+    case LogField::Type::boolean:
+      return LogField(key, value != 0);
+    case LogField::Type::signed_integer:
+      return LogField(key, std::bit_cast<std::int64_t>(value));
+    case LogField::Type::unsigned_integer:
+      return LogField(key, value);
+    case LogField::Type::floating_point:
+      return LogField(key, std::bit_cast<double>(value));
+    case LogField::Type::string:
+      break;
+    }
+    return LogField(key, std::string_view(text));
+  }
+};
+
+using DecodedArgument =
+    std::variant<bool, char, std::int64_t, std::uint64_t, float, double,
+                 const void *, std::string_view>;
+
+template <typename Stored, typename Decoded = Stored>
+bool read_value(std::string_view &bytes, DecodedArgument &argument) noexcept {
+  if (bytes.size() < sizeof(Stored))
+    return false;
+  Stored value;
+  std::memcpy(&value, bytes.data(), sizeof(Stored));
+  bytes.remove_prefix(sizeof(Stored));
+  argument = static_cast<Decoded>(value);
+  return true;
+}
+
+bool read_argument(DeferredType type, std::string_view &bytes,
+                   DecodedArgument &argument) noexcept {
+  using Type = DeferredType;
+  switch (type) {
+  case Type::boolean:
+    return read_value<bool>(bytes, argument);
+  case Type::character:
+    return read_value<char>(bytes, argument);
+  case Type::int8:
+    return read_value<std::int8_t, std::int64_t>(bytes, argument);
+  case Type::int16:
+    return read_value<std::int16_t, std::int64_t>(bytes, argument);
+  case Type::int32:
+    return read_value<std::int32_t, std::int64_t>(bytes, argument);
+  case Type::int64:
+    return read_value<std::int64_t>(bytes, argument);
+  case Type::uint8:
+    return read_value<std::uint8_t, std::uint64_t>(bytes, argument);
+  case Type::uint16:
+    return read_value<std::uint16_t, std::uint64_t>(bytes, argument);
+  case Type::uint32:
+    return read_value<std::uint32_t, std::uint64_t>(bytes, argument);
+  case Type::uint64:
+    return read_value<std::uint64_t>(bytes, argument);
+  case Type::float32:
+    return read_value<float>(bytes, argument);
+  case Type::float64:
+    return read_value<double>(bytes, argument);
+  case Type::pointer:
+    return read_value<const void *>(bytes, argument);
+  case Type::string: {
+    std::size_t size;
+    if (bytes.size() < sizeof(size))
+      return false;
+    std::memcpy(&size, bytes.data(), sizeof(size));
+    bytes.remove_prefix(sizeof(size));
+    if (bytes.size() < size)
+      return false;
+    argument = bytes.substr(0, size);
+    bytes.remove_prefix(size);
+    return true;
+  }
+  case Type::other:
+    break;
+  }
+  return false;
+}
+
+/**
+ * Formats a message from decoded arguments. Replacement fields are formatted
+ * one at a time, since the argument types are only known at runtime.
+ * @note Dynamic widths and precisions (like "{:{}}") are not supported; the
+ * sink stores such messages as text.
+ */
+void format_decoded(std::string_view format,
+                    const std::vector<DecodedArgument> &arguments,
+                    std::string &out) noexcept {
+  auto next_argument = std::size_t{0};
+  auto i = std::size_t{0};
+  while (i < format.size()) {
+    auto c = format[i];
+    if (c == '}') {
+      out.push_back('}');
+      i += i + 1 < format.size() && format[i + 1] == '}' ? 2 : 1;
+      continue;
+    }
+    if (c != '{') {
+      out.push_back(c);
+      ++i;
+      continue;
+    }
+    if (i + 1 < format.size() && format[i + 1] == '{') {
+      out.push_back('{');
+      i += 2;
+      continue;
+    }
+    auto close = format.find('}', i);
+    if (close == std::string_view::npos) {
+      out.append(format.substr(i));
+      return;
+    }
+    auto field = format.substr(i + 1, close - i - 1);
+    auto colon = field.find(':');
+    auto index_text = field.substr(0, colon);
+    auto spec = colon == std::string_view::npos ? std::string_view()
+                                                : field.substr(colon);
+    auto index = next_argument++;
+    if (!index_text.empty()) {
+      index = 0;
+      for (auto digit : index_text)
+        index = index * 10 + static_cast<std::size_t>(digit - '0');
+    }
+    i = close + 1;
+    if (index >= arguments.size()) {
+      out.append("<missing argument>");
+      continue;
+    }
+    auto single = std::string("{");
+    single.append(spec).push_back('}');
+    std::visit(
+        [&](const auto &argument) {
+          try {
+            std::vformat_to(std::back_inserter(out), single,
+                            std::make_format_args(argument));
+          } catch (const std::exception &e) {
+            out.append("<format error: ").append(e.what()).append(">");
+          }
+        },
+        arguments[index]);
+  }
+}
+
+/**
+ * Renders the entries of a binary log, keeping the format table seen so far.
+ */
+struct Decoder {
+  std::ostream &out;
+  const BinaryLogFilter &filter;
+  // Seconds per tick of the writer's clock
+  double period;
+  std::unordered_map<std::uint32_t, StoredFormat> formats{};
+  std::vector<DecodedArgument> arguments{};
+  std::vector<StoredField> stored_fields{};
+  std::vector<LogField> fields{};
+  std::string bytes{};
+  std::string line{};
+  std::string block{};
+  std::string compressed{};
+
+  /**
+   * Decodes entries until the end of in. Blocks may only appear at the top
+   * level, not inside other blocks.
+   */
+  bool decode(std::istream &in, bool top_level) noexcept {
+    char tag;
+    while (in.get(tag)) {
+      auto valid = tag == 'F'                ? read_format(in)
+                   : tag == 'R'              ? read_record(in)
+                   : tag == 'B' && top_level ? read_block(in)
+                                             : false;
+      if (!valid)
+        return false;
+    }
+    return in.eof();
+  }
+
+  bool read_format(std::istream &in) noexcept {
+    std::uint32_t id, size;
+    std::uint8_t count;
+    if (!get(in, id) || !get(in, count))
+      return false;
+    auto &format = formats[id];
+    format.types.resize(count);
+    for (auto &type : format.types) {
+      std::uint8_t value;
+      if (!get(in, value) ||
+          value > static_cast<std::uint8_t>(DeferredType::string))
+        return false;
+      type = static_cast<DeferredType>(value);
+    }
+    if (!get(in, size))
+      return false;
+    format.text.resize(size);
+    return static_cast<bool>(in.read(format.text.data(), size));
+  }
+
+  bool read_block(std::istream &in) noexcept {
+    std::int64_t earliest, latest;
+    std::uint32_t size, compressed_size;
+    if (!get(in, earliest) || !get(in, latest) || !get(in, size) ||
+        !get(in, compressed_size))
+      return false;
+    // Blocks without a single record in the time range are skipped unread
+    if ((filter.from || filter.to) &&
+        (earliest > latest ||
+         (filter.from && static_cast<double>(latest) * period < *filter.from) ||
+         (filter.to && static_cast<double>(earliest) * period > *filter.to))) {
+      if (in.seekg(compressed_size, std::ios::cur))
+        return true;
+      in.clear();
+      return static_cast<bool>(in.ignore(compressed_size)) &&
+             in.gcount() == compressed_size;
+    }
+    compressed.resize(compressed_size);
+    if (!in.read(compressed.data(), compressed_size) ||
+        !decompress_block(compressed, size, block))
+      return false;
+    auto records = std::istringstream(block);
+    return decode(records, false);
+  }
+
+  bool read_record(std::istream &in) noexcept {
+    std::uint8_t level, flags;
+    std::uint32_t id, size;
+    auto record = LogRecord{};
+    if (!get(in, level) || level > static_cast<std::uint8_t>(LogLevel::fatal) ||
+        !get(in, flags))
+      return false;
+    record.level = static_cast<LogLevel>(level);
+    record.has_timestamp = (flags & timestamp_flag) != 0;
+    record.has_thread = (flags & thread_flag) != 0;
+    std::int64_t ticks = 0;
+    if ((record.has_timestamp && !get(in, ticks)) ||
+        (record.has_thread && !get(in, record.thread)) || !get(in, id) ||
+        !get(in, size))
+      return false;
+    bytes.resize(size);
+    if (!in.read(bytes.data(), size))
+      return false;
+    fields.clear();
+    if (flags & fields_flag) {
+      std::uint32_t count;
+      if (!get(in, count))
+        return false;
+      if (stored_fields.size() < count)
+        stored_fields.resize(count);
+      for (std::uint32_t i = 0; i < count; ++i) {
+        if (!stored_fields[i].read(in))
+          return false;
+        fields.push_back(stored_fields[i].field());
+      }
+    }
+
+    auto seconds = static_cast<double>(ticks) * period;
+    if (record.level < filter.minimum ||
+        (filter.thread &&
+         (!record.has_thread || record.thread != *filter.thread)) ||
+        ((filter.from || filter.to) && !record.has_timestamp) ||
+        (filter.from && seconds < *filter.from) ||
+        (filter.to && seconds > *filter.to))
+      return true;
+
+    // Timestamps are converted to this build's clock, for format_log_header()
+    record.timestamp = std::chrono::duration_cast<Clock::duration>(
+                           std::chrono::duration<double>(seconds))
+                           .count();
+    auto header_buffer = LogHeaderBuffer{};
+    line.assign(format_log_header(record, header_buffer));
+    line.append(log_file_label(record.level));
+    if (id == 0) {
+      line.append(bytes);
+    } else {
+      auto format = formats.find(id);
+      if (format == formats.end())
+        return false;
+      auto remaining = std::string_view(bytes);
+      arguments.resize(format->second.types.size());
+      for (std::size_t i = 0; i < arguments.size(); ++i)
+        if (!read_argument(format->second.types[i], remaining, arguments[i]))
+          return false;
+      format_decoded(format->second.text, arguments, line);
+    }
+    record.fields = fields;
+    format_log_fields(record, line);
+    line.push_back('\n');
+    out.write(line.data(), static_cast<std::streamsize>(line.size()));
+    return true;
+  }
+};
+} // namespace
+
+bool BinaryLogSink::open(const std::filesystem::path &path,
+                         const BinaryLogSettings &settings) noexcept {
+  auto &state = binary_log();
+  // Constructed after the state, so destroyed before it
+  static BinaryLogShutdown shutdown;
+  auto lock = std::scoped_lock(state.mutex);
+  if (state.file.is_open())
+    return false;
+  state.file.open(path, std::ios::binary | std::ios::trunc);
+  if (!state.file.is_open())
+    return false;
+  state.settings = settings;
+  state.format_ids.clear();
+  state.buffer.clear();
+  state.buffer.append(magic);
+  put(state.buffer, version);
+  put(state.buffer, static_cast<std::uint8_t>(sizeof(std::size_t)));
+  put(state.buffer, byte_order_mark);
+  put(state.buffer, static_cast<std::uint64_t>(Clock::duration::period::num));
+  put(state.buffer, static_cast<std::uint64_t>(Clock::duration::period::den));
+  if (settings.compress) {
+    // The header is not part of any block
+    state.flush();
+    state.writer.running = true;
+    state.writer.thread =
+        std::thread([&state] { state.writer.run(state.file); });
+  }
+  return true;
+}
+
+void BinaryLogSink::close() noexcept {
+  auto &state = binary_log();
+  auto lock = std::scoped_lock(state.mutex);
+  if (!state.file.is_open())
+    return;
+  if (state.settings.compress) {
+    state.seal_block();
+    {
+      auto writer_lock = std::scoped_lock(state.writer.mutex);
+      state.writer.running = false;
+    }
+    state.writer.changed.notify_all();
+    state.writer.thread.join();
+  } else {
+    state.flush();
+  }
+  state.file.close();
+}
+
+bool BinaryLogSink::is_open() noexcept {
+  auto &state = binary_log();
+  auto lock = std::scoped_lock(state.mutex);
+  return state.file.is_open();
+}
+
+void BinaryLogSink::write(const LogRecord &record) noexcept {
+  auto &state = binary_log();
+  const auto *deferred = record.deferred;
+  auto stored = deferred && decodable(*deferred);
+  // Anything that cannot be stored as arguments is formatted before locking
+  thread_local auto text = std::string{};
+  if (!stored) {
+    text.clear();
+    if (deferred)
+      deferred->format_to(text);
+    else
+      text.append(record.message);
+  }
+
+  auto lock = std::scoped_lock(state.mutex);
+  if (!state.file.is_open())
+    return;
+  auto id = stored ? state.format_id(*deferred) : std::uint32_t{0};
+  if (stored && id == 0) {
+    // Rare enough to be formatted while locked
+    stored = false;
+    text.clear();
+    deferred->format_to(text);
+  }
+  auto &out = state.buffer;
+  if (record.has_timestamp) {
+    auto timestamp = static_cast<std::int64_t>(record.timestamp);
+    state.earliest = std::min(state.earliest, timestamp);
+    state.latest = std::max(state.latest, timestamp);
+  }
+  out.push_back('R');
+  put(out, static_cast<std::uint8_t>(record.level));
+  auto flags = (record.has_timestamp ? timestamp_flag : 0) |
+               (record.has_thread ? thread_flag : 0) |
+               (record.fields.empty() ? 0 : fields_flag);
+  put(out, static_cast<std::uint8_t>(flags));
+  if (record.has_timestamp)
+    put(out, static_cast<std::int64_t>(record.timestamp));
+  if (record.has_thread)
+    put(out, record.thread);
+  put(out, id);
+  if (stored) {
+    auto arguments = deferred->arguments();
+    put(out, static_cast<std::uint32_t>(arguments.size()));
+    out.append(reinterpret_cast<const char *>(arguments.data()),
+               arguments.size());
+  } else {
+    put_text(out, text);
+  }
+  if (!record.fields.empty())
+    put_fields(out, record.fields);
+  if (state.settings.compress) {
+    if (out.size() >= state.settings.block_size)
+      state.seal_block();
+  } else if (out.size() >= flush_size) {
+    state.flush();
+  }
+}
+
+bool decode_binary_log(std::istream &in, std::ostream &out,
+                       const BinaryLogFilter &filter) noexcept {
+  auto header = std::array<char, magic.size()>{};
+  std::uint8_t file_version, size_width;
+  std::uint32_t file_byte_order;
+  std::uint64_t period_num, period_den;
+  if (!in.read(header.data(), header.size()) ||
+      std::string_view(header.data(), header.size()) != magic ||
+      !get(in, file_version) || file_version != version ||
+      !get(in, size_width) || size_width != sizeof(std::size_t) ||
+      !get(in, file_byte_order) || file_byte_order != byte_order_mark ||
+      !get(in, period_num) || !get(in, period_den) || period_den == 0)
+    return false;
+  auto decoder = Decoder{.out = out,
+                         .filter = filter,
+                         .period = static_cast<double>(period_num) /
+                                   static_cast<double>(period_den)};
+  return decoder.decode(in, true);
+}
+} // namespace junco
\ No newline at end of file
@@ -0,0 +1,144 @@
+#include "junco/compression.hpp"
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+namespace junco {
+namespace {
+constexpr std::size_t min_match = 4;
+constexpr std::size_t max_offset = 65535;
+// The format requires the last 5 bytes to be literals, and the last match to
+// start at least 12 bytes before the end of the block
+constexpr std::size_t last_literals = 5;
+constexpr std::size_t match_start_margin = 12;
+constexpr int hash_bits = 12;
+
+std::uint32_t read32(const char *data) noexcept {
+  std::uint32_t value;
+  std::memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+std::uint32_t hash(std::uint32_t sequence) noexcept {
+  return (sequence * 2654435761u) >> (32 - hash_bits);
+}
+
+/**
+ * Writes the part of a length that does not fit in its 4 bits of the token.
+ */
+void put_length(std::string &out, std::size_t extra) noexcept {
+  for (; extra >= 255; extra -= 255)
+    out.push_back(static_cast<char>(255));
+  out.push_back(static_cast<char>(extra));
+}
+
+/**
+ * Reads the rest of a length whose token bits were all set.
+ */
+bool get_length(std::string_view input, std::size_t &pos,
+                std::size_t &length) noexcept {
+  for (;;) {
+    if (pos >= input.size())
+      return false;
+    auto byte = static_cast<unsigned char>(input[pos++]);
+    length += byte;
+    if (byte != 255)
+      return true;
+  }
+}
+
+/**
+ * Writes the literals in [anchor, anchor + literals), followed by a match of
+ * match_length bytes (if any) starting offset bytes back.
+ */
+void put_sequence(std::string &out, const char *anchor, std::size_t literals,
+                  std::size_t offset, std::size_t match_length) noexcept {
+  auto literal_bits = literals < 15 ? literals : 15;
+  auto match_bits = std::size_t{0};
+  if (match_length != 0)
+    match_bits = match_length - min_match < 15 ? match_length - min_match : 15;
+  out.push_back(static_cast<char>(literal_bits << 4 | match_bits));
+  if (literal_bits == 15)
+    put_length(out, literals - 15);
+  out.append(anchor, literals);
+  if (match_length == 0)
+    return;
+  out.push_back(static_cast<char>(offset & 0xFF));
+  out.push_back(static_cast<char>(offset >> 8));
+  if (match_bits == 15)
+    put_length(out, match_length - min_match - 15);
+}
+} // namespace
+
+void compress_block(std::string_view input, std::string &out) noexcept {
+  const auto *data = input.data();
+  auto size = input.size();
+  auto anchor = std::size_t{0};
+  if (size > match_start_margin) {
+    // Positions are stored plus one, so that 0 marks an empty slot
+    auto table = std::array<std::uint32_t, 1u << hash_bits>{};
+    auto match_limit = size - last_literals;
+    auto i = std::size_t{0};
+    while (i < size - match_start_margin) {
+      auto sequence = read32(data + i);
+      auto &slot = table[hash(sequence)];
+      auto candidate = static_cast<std::size_t>(slot);
+      slot = static_cast<std::uint32_t>(i + 1);
+      if (candidate == 0 || i + 1 - candidate > max_offset ||
+          read32(data + candidate - 1) != sequence) {
+        // Step faster through data that does not compress
+        i += 1 + ((i - anchor) >> 6);
+        continue;
+      }
+      auto match = candidate - 1;
+      auto length = min_match;
+      while (i + length < match_limit &&
+             data[match + length] == data[i + length])
+        ++length;
+      put_sequence(out, data + anchor, i - anchor, i - match, length);
+      i += length;
+      anchor = i;
+    }
+  }
+  put_sequence(out, data + anchor, size - anchor, 0, 0);
+}
+
+bool decompress_block(std::string_view input, std::size_t size,
+                      std::string &out) noexcept {
+  out.resize(size);
+  auto *data = out.data();
+  auto written = std::size_t{0};
+  auto pos = std::size_t{0};
+  while (pos < input.size()) {
+    auto token = static_cast<unsigned char>(input[pos++]);
+    auto literals = static_cast<std::size_t>(token >> 4);
+    if (literals == 15 && !get_length(input, pos, literals))
+      return false;
+    if (literals > input.size() - pos || literals > size - written)
+      return false;
+    std::memcpy(data + written, input.data() + pos, literals);
+    pos += literals;
+    written += literals;
+    // The last sequence has no match
+    if (pos == input.size())
+      break;
+
+    if (input.size() - pos < 2)
+      return false;
+    auto offset = static_cast<std::size_t>(
+        static_cast<unsigned char>(input[pos]) |
+        static_cast<unsigned char>(input[pos + 1]) << 8);
+    pos += 2;
+    auto length = static_cast<std::size_t>(token & 15);
+    if (length == 15 && !get_length(input, pos, length))
+      return false;
+    length += min_match;
+    if (offset == 0 || offset > written || length > size - written)
+      return false;
+    // Matches may overlap the bytes they produce, so copy them in order
+    for (auto end = written + length; written < end; ++written)
+      data[written] = data[written - offset];
+  }
+  return written == size;
+}
+} // namespace junco
\ No newline at end of file
@@ -0,0 +1,872 @@
+#include "junco/log.hpp"
+#include "junco/ring_buffer.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <syncstream>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+namespace junco {
+namespace {
+/**
+ * A message waiting for the writer thread. Deferred messages are formatted by
+ * the writer, straight into its output batch.
+ */
+struct QueuedMessage {
+  // Longer messages are copied to the heap
+  static constexpr std::size_t inline_capacity = 256;
+
+  void set_text(std::string_view text) noexcept {
+    text_size = text.size();
+    if (text_size <= inline_capacity)
+      std::memcpy(inline_text.data(), text.data(), text_size);
+    else
+      heap_text.assign(text);
+  }
+  std::string_view text() const noexcept {
+    if (text_size <= inline_capacity)
+      return std::string_view(inline_text.data(), text_size);
+    return heap_text;
+  }
+
+  // The record's message is left empty; its text is stored below
+  LogRecord record;
+  std::size_t text_size = 0;
+  std::array<char, inline_capacity> inline_text;
+  std::string heap_text;
+  DeferredFormat deferred;
+};
+
+/**
+ * Writes a batch of lines to a stream as a single piece, then clears it.
+ */
+void write_batch(std::string &batch, std::ostream &strm) noexcept {
+  if (batch.empty())
+    return;
+  auto synced = std::osyncstream(strm);
+  synced.write(batch.data(), static_cast<std::streamsize>(batch.size()));
+  synced << std::flush;
+  batch.clear();
+}
+
+/**
+ * Background thread that drains queued messages and writes them to
+ * stdout/stderr in batches.
+ */
+class AsyncWriter final {
+public:
+  explicit AsyncWriter(const AsyncLogSettings &settings)
+      : queue(settings.capacity), overflow(settings.overflow) {
+    thread = std::thread([this] { run(); });
+  }
+  ~AsyncWriter() { stop(); }
+
+  bool push(QueuedMessage &&message) noexcept {
+    while (!queue.try_push(std::move(message))) {
+      switch (overflow) {
+      case OverflowPolicy::block:
+        wake();
+        std::this_thread::yield();
+        break;
+      case OverflowPolicy::drop_newest:
+        dropped_count.fetch_add(1, std::memory_order_relaxed);
+        return true;
+      case OverflowPolicy::drop_oldest:
+        auto discarded = QueuedMessage{};
+        if (queue.try_pop(discarded))
+          dropped_count.fetch_add(1, std::memory_order_relaxed);
+        break;
+      }
+    }
+    // Pairs with the fence in run(), so that either the writer sees the new
+    // message or this thread sees that the writer is asleep
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping.load(std::memory_order_relaxed))
+      wake();
+    return true;
+  }
+
+  /**
+   * Blocks until every queued message has been written.
+   */
+  void flush() noexcept {
+    wake();
+    while (!queue.empty() || busy.load())
+      std::this_thread::yield();
+  }
+
+  void stop() noexcept {
+    if (!thread.joinable())
+      return;
+    running.store(false, std::memory_order_release);
+    wake();
+    thread.join();
+  }
+
+  std::size_t dropped() const noexcept {
+    return dropped_count.load(std::memory_order_relaxed);
+  }
+
+private:
+  // Batches are written early once they grow past this size
+  static constexpr std::size_t max_batch_size = 64 * 1024;
+
+  void run() noexcept {
+    for (;;) {
+      auto keep_running = running.load(std::memory_order_acquire);
+      busy.store(true);
+      drain();
+      busy.store(false);
+      if (!keep_running)
+        return;
+
+      auto ticket = signal.load(std::memory_order_acquire);
+      sleeping.store(true, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (queue.empty() && running.load(std::memory_order_acquire))
+        signal.wait(ticket, std::memory_order_acquire);
+      sleeping.store(false, std::memory_order_relaxed);
+    }
+  }
+
+  void drain() noexcept {
+    auto message = QueuedMessage{};
+    while (queue.try_pop(message)) {
+      const auto &s = StandardLogger::style(message.record.level);
+      auto &batch = s.use_stderr ? err_batch : out_batch;
+      batch.append(format_log_header(message.record, header));
+      batch.append(s.prefix);
+      if (message.deferred.empty())
+        batch.append(message.text());
+      else
+        message.deferred.format_to(batch);
+      batch.append(s.suffix);
+      batch.push_back('\n');
+      if (batch.size() >= max_batch_size)
+        write_batch(batch, s.use_stderr ? std::cerr : std::cout);
+    }
+    write_batch(out_batch, std::cout);
+    write_batch(err_batch, std::cerr);
+  }
+
+  void wake() noexcept {
+    signal.fetch_add(1, std::memory_order_release);
+    signal.notify_one();
+  }
+
+  RingBuffer<QueuedMessage> queue;
+  OverflowPolicy overflow;
+  std::atomic<std::size_t> dropped_count{0};
+  std::atomic<bool> running{true};
+  std::atomic<bool> sleeping{false};
+  std::atomic<bool> busy{false};
+  std::atomic<std::uint32_t> signal{0};
+  std::string out_batch;
+  std::string err_batch;
+  LogHeaderBuffer header;
+  std::thread thread;
+};
+
+std::mutex control_mutex;
+std::atomic<AsyncWriter *> writer{nullptr};
+// Number of threads currently inside push_async()
+std::atomic<std::size_t> in_flight{0};
+std::size_t last_dropped = 0;
+
+/**
+ * Pushes a message to the writer thread, if it is running. Fatal messages are
+ * never queued; the writer is flushed so that they are written after every
+ * message sent before them.
+ */
+bool push_async(QueuedMessage &&message,
+                const std::atomic<bool> &enabled) noexcept {
+  auto queued = false;
+  in_flight.fetch_add(1);
+  if (enabled.load()) {
+    auto *current = writer.load(std::memory_order_acquire);
+    if (message.record.level == LogLevel::fatal)
+      current->flush();
+    else
+      queued = current->push(std::move(message));
+  }
+  in_flight.fetch_sub(1, std::memory_order_release);
+  return queued;
+}
+
+/**
+ * Lines written by one thread while buffering is enabled. The mutex is only
+ * contended when another thread flushes every buffer.
+ */
+struct LineBuffer {
+  LineBuffer() noexcept;
+  ~LineBuffer();
+
+  void flush() noexcept {
+    auto lock = std::scoped_lock(mutex);
+    write_batch(out, std::cout);
+    write_batch(err, std::cerr);
+  }
+
+  std::mutex mutex;
+  std::string out;
+  std::string err;
+  // Clock ticks when the oldest buffered line was added
+  Clock::duration::rep oldest = 0;
+};
+
+struct LineBufferRegistry {
+  std::mutex mutex;
+  std::vector<LineBuffer *> buffers;
+};
+LineBufferRegistry &line_buffers() noexcept {
+  static LineBufferRegistry registry;
+  return registry;
+}
+std::atomic<std::size_t> buffer_max_bytes{0};
+std::atomic<Clock::duration::rep> buffer_max_ticks{0};
+
+LineBuffer::LineBuffer() noexcept {
+  auto &registry = line_buffers();
+  auto lock = std::scoped_lock(registry.mutex);
+  registry.buffers.push_back(this);
+}
+
+LineBuffer::~LineBuffer() {
+  auto &registry = line_buffers();
+  {
+    auto lock = std::scoped_lock(registry.mutex);
+    std::erase(registry.buffers, this);
+  }
+  flush();
+}
+
+void flush_line_buffers() noexcept {
+  auto &registry = line_buffers();
+  auto lock = std::scoped_lock(registry.mutex);
+  for (auto *buffer : registry.buffers)
+    buffer->flush();
+}
+
+/**
+ * Every live LogTag, so that changes to the global level reach all of them.
+ * Function-local so that tags can be created during static initialization.
+ */
+struct TagRegistry {
+  std::mutex mutex;
+  LogTag *head = nullptr;
+};
+TagRegistry &tag_registry() noexcept {
+  static TagRegistry registry;
+  return registry;
+}
+
+/**
+ * Every distinct configuration of log functions and sinks installed so far.
+ * Snapshots are never freed, since other threads may still be dispatching
+ * through a replaced one. The mutex also serializes changes to the active
+ * snapshot.
+ */
+template <typename Dispatch> struct DispatchSnapshots {
+  std::mutex mutex;
+  std::vector<std::unique_ptr<const Dispatch>> snapshots;
+};
+template <typename Dispatch>
+DispatchSnapshots<Dispatch> &dispatch_snapshots() noexcept {
+  static DispatchSnapshots<Dispatch> snapshots;
+  return snapshots;
+}
+
+// Levels recorded by the backtrace (trace and standard)
+constexpr std::uint8_t backtrace_levels = 0b11;
+
+/**
+ * One recorded message. Longer messages are cut short.
+ */
+struct BacktraceEntry {
+  static constexpr std::size_t text_capacity = 160;
+  LogLevel level;
+  std::uint16_t size;
+  std::array<char, text_capacity> text;
+};
+
+/**
+ * The recent messages of a single thread. Only the owning thread writes to a
+ * ring; dumps read it without locking, so they are best-effort if the owner
+ * is still logging.
+ */
+struct BacktraceRing {
+  std::unique_ptr<BacktraceEntry[]> entries;
+  std::size_t capacity = 0;
+  std::uint32_t thread_index = 0;
+  std::atomic<std::size_t> written{0};
+  // Cleared when the owning thread exits, so a new thread can reuse the ring
+  std::atomic<bool> in_use{true};
+  BacktraceRing *next = nullptr;
+};
+
+// Rings are never freed, so that dumps (which may run in a signal handler) can
+// walk this list without locking. New rings are pushed to the front.
+std::atomic<BacktraceRing *> backtrace_rings{nullptr};
+std::atomic<std::size_t> backtrace_lines{64};
+
+struct BacktraceOwner {
+  ~BacktraceOwner() {
+    if (ring)
+      ring->in_use.store(false, std::memory_order_release);
+  }
+  BacktraceRing *ring = nullptr;
+};
+thread_local BacktraceOwner backtrace_owner;
+
+BacktraceRing *acquire_ring() noexcept {
+  auto lines = backtrace_lines.load(std::memory_order_relaxed);
+  for (auto *ring = backtrace_rings.load(); ring; ring = ring->next) {
+    auto expected = false;
+    if (ring->capacity == lines &&
+        ring->in_use.compare_exchange_strong(expected, true)) {
+      ring->written.store(0);
+      ring->thread_index = StandardLogger::thread_index();
+      return ring;
+    }
+  }
+  auto *ring = new BacktraceRing();
+  ring->entries = std::make_unique<BacktraceEntry[]>(lines);
+  ring->capacity = lines;
+  ring->thread_index = StandardLogger::thread_index();
+  ring->next = backtrace_rings.load();
+  while (!backtrace_rings.compare_exchange_weak(ring->next, ring))
+    ;
+  return ring;
+}
+
+void write_fd(int fd, std::string_view text) noexcept {
+  while (!text.empty()) {
+#if defined(_WIN32)
+    auto written =
+        ::_write(fd, text.data(), static_cast<unsigned>(text.size()));
+#else
+    auto written = ::write(fd, text.data(), text.size());
+#endif
+    if (written <= 0)
+      return;
+    text.remove_prefix(static_cast<std::size_t>(written));
+  }
+}
+void write_number(int fd, std::uint32_t value) noexcept {
+  auto digits = std::array<char, 10>();
+  auto first = digits.size();
+  do {
+    digits[--first] = static_cast<char>('0' + value % 10);
+    value /= 10;
+  } while (value != 0);
+  write_fd(fd, std::string_view(digits.data() + first, digits.size() - first));
+}
+
+// Signals that dump the backtrace, and the handlers installed before ours
+#if defined(SIGBUS)
+constexpr std::array<int, 5> crash_signals{SIGSEGV, SIGABRT, SIGFPE, SIGILL,
+                                           SIGBUS};
+#else
+constexpr std::array<int, 4> crash_signals{SIGSEGV, SIGABRT, SIGFPE, SIGILL};
+#endif
+#if defined(_WIN32)
+std::array<void (*)(int), crash_signals.size()> previous_handlers{};
+#else
+std::array<struct sigaction, crash_signals.size()> previous_actions{};
+#endif
+
+/**
+ * Dumps the backtrace, then restores the handler that was installed before
+ * ours (the default one, unless the application, a sanitizer or a crash
+ * reporter set another) and re-raises the signal, so that it runs next.
+ */
+extern "C" void handle_crash_signal(int signal) {
+  StandardLogger::dump_backtrace();
+  for (std::size_t i = 0; i < crash_signals.size(); ++i) {
+    if (crash_signals[i] != signal)
+      continue;
+#if defined(_WIN32)
+    std::signal(signal, previous_handlers[i]);
+#else
+    sigaction(signal, &previous_actions[i], nullptr);
+#endif
+  }
+  std::raise(signal);
+}
+
+void install_crash_handlers() noexcept {
+  static std::once_flag installed;
+  std::call_once(installed, [] {
+    for (std::size_t i = 0; i < crash_signals.size(); ++i) {
+#if defined(_WIN32)
+      previous_handlers[i] = std::signal(crash_signals[i], handle_crash_signal);
+      if (previous_handlers[i] == SIG_ERR)
+        previous_handlers[i] = SIG_DFL;
+#else
+      struct sigaction action {};
+      action.sa_handler = handle_crash_signal;
+      sigemptyset(&action.sa_mask);
+      // Keep working on the alternate stack, if one was set up for overflows
+      action.sa_flags = SA_ONSTACK;
+      sigaction(crash_signals[i], &action, &previous_actions[i]);
+#endif
+    }
+  });
+}
+
+/**
+ * Runs terminal detection once, during static initialization.
+ */
+struct ColorDetection {
+  ColorDetection() noexcept { StandardLogger::detect_colors(); }
+} color_detection;
+
+/**
+ * Stops the writer thread during static destruction if the user did not.
+ */
+struct AsyncShutdown {
+  ~AsyncShutdown() { StandardLogger::stop_async(); }
+};
+
+constexpr std::array<std::string_view, 5> level_names{
+    "trace", "standard", "warning", "error", "fatal"};
+
+void append_field_value(const LogField &field, std::string &out) noexcept {
+  auto inserter = std::back_inserter(out);
+  switch (field.type()) {
+  case LogField::Type::boolean:
+    out.append(field.as_bool() ? "true" : "false");
+    break;
+  case LogField::Type::signed_integer:
+    std::format_to(inserter, "{}", field.as_signed());
+    break;
+  case LogField::Type::unsigned_integer:
+    std::format_to(inserter, "{}", field.as_unsigned());
+    break;
+  case LogField::Type::floating_point:
+    std::format_to(inserter, "{}", field.as_double());
+    break;
+  case LogField::Type::string:
+    break;
+  }
+}
+
+// FNV-1a, used to compare messages without keeping a copy of them
+std::uint64_t hash_message(std::string_view msg) noexcept {
+  auto hash = std::uint64_t{14695981039346656037u};
+  for (auto c : msg) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 1099511628211u;
+  }
+  return hash;
+}
+} // namespace
+
+void append_json_string(std::string_view str, std::string &out) noexcept {
+  out.push_back('"');
+  for (auto c : str) {
+    switch (c) {
+    case '"':
+      out.append("\\\"");
+      break;
+    case '\\':
+      out.append("\\\\");
+      break;
+    case '\n':
+      out.append("\\n");
+      break;
+    case '\t':
+      out.append("\\t");
+      break;
+    default:
+      if (static_cast<unsigned char>(c) < 0x20)
+        std::format_to(std::back_inserter(out), "\\u{:04x}",
+                       static_cast<unsigned>(c));
+      else
+        out.push_back(c);
+    }
+  }
+  out.push_back('"');
+}
+
+void format_log_fields(const LogRecord &record, std::string &out) noexcept {
+  for (const auto &field : record.fields) {
+    out.push_back(' ');
+    out.append(field.key());
+    out.push_back('=');
+    if (field.type() == LogField::Type::string)
+      append_json_string(field.as_string(), out);
+    else
+      append_field_value(field, out);
+  }
+}
+
+void format_log_json(const LogRecord &record, std::string &out) noexcept {
+  auto inserter = std::back_inserter(out);
+  out.append("{\"level\":\"");
+  out.append(level_names[static_cast<std::size_t>(record.level)]);
+  out.push_back('"');
+  if (record.has_timestamp)
+    std::format_to(inserter, ",\"time\":{:.6f}",
+                   Clock::to_seconds(record.timestamp));
+  if (record.has_thread)
+    std::format_to(inserter, ",\"thread\":{}", record.thread);
+  if (record.location.line() != 0) {
+    out.append(",\"file\":");
+    append_json_string(record.location.file_name(), out);
+    std::format_to(inserter, ",\"line\":{}", record.location.line());
+  }
+  out.append(",\"message\":");
+  append_json_string(record.message, out);
+  if (!record.fields.empty()) {
+    out.append(",\"fields\":{");
+    auto first = true;
+    for (const auto &field : record.fields) {
+      if (!first)
+        out.push_back(',');
+      first = false;
+      append_json_string(field.key(), out);
+      out.push_back(':');
+      if (field.type() == LogField::Type::string)
+        append_json_string(field.as_string(), out);
+      else if (field.type() == LogField::Type::floating_point &&
+               !std::isfinite(field.as_double()))
+        out.append("null"); // JSON has no infinity or NaN
+      else
+        append_field_value(field, out);
+    }
+    out.push_back('}');
+  }
+  out.push_back('}');
+}
+
+bool LogSite::admit() noexcept {
+  if (limit.per_second == 0)
+    return true;
+  auto now = std::chrono::duration_cast<std::chrono::seconds>(
+                 std::chrono::steady_clock::now().time_since_epoch())
+                 .count();
+  // The thread that moves the window forward resets its count; messages
+  // counted by other threads in the meantime may be lost, which only lets a
+  // few extra messages through
+  auto current = window.load(std::memory_order_relaxed);
+  if (current != now &&
+      window.compare_exchange_strong(current, now, std::memory_order_relaxed))
+    window_count.store(0, std::memory_order_relaxed);
+  if (window_count.fetch_add(1, std::memory_order_relaxed) < limit.per_second)
+    return true;
+  suppressed.fetch_add(1, std::memory_order_relaxed);
+  return false;
+}
+
+bool LogSite::repeats(std::string_view msg) noexcept {
+  if (!limit.collapse_repeats)
+    return false;
+  // 0 is reserved for "no previous message"
+  auto hash = hash_message(msg) | 1u;
+  if (last_hash.exchange(hash, std::memory_order_relaxed) != hash)
+    return false;
+  suppressed.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+LogTag::LogTag(std::string_view name, LogLevel minimum) noexcept
+    : tag_name(name), threshold(minimum), mask(0) {
+  auto &registry = tag_registry();
+  auto lock = std::scoped_lock(registry.mutex);
+  next = registry.head;
+  registry.head = this;
+  refresh(StandardLogger::enabled_levels.load(std::memory_order_relaxed));
+}
+
+LogTag::~LogTag() {
+  auto &registry = tag_registry();
+  auto lock = std::scoped_lock(registry.mutex);
+  for (auto **link = &registry.head; *link; link = &(*link)->next) {
+    if (*link == this) {
+      *link = next;
+      break;
+    }
+  }
+}
+
+void LogTag::set_level(LogLevel minimum) noexcept {
+  auto lock = std::scoped_lock(tag_registry().mutex);
+  threshold = minimum;
+  refresh(StandardLogger::enabled_levels.load(std::memory_order_relaxed));
+}
+
+void LogTag::refresh(std::uint8_t global_mask) noexcept {
+  mask.store(global_mask & log_levels_from(threshold),
+             std::memory_order_relaxed);
+}
+
+void StandardLogger::set_log_functions(
+    const LogFunctions &new_functions) noexcept {
+  update_dispatch([&](Dispatch &next) { next.functions = new_functions; });
+}
+
+void StandardLogger::add_sink(const LogSink &sink) noexcept {
+  update_dispatch([&](Dispatch &next) { next.sinks.push_back(sink); });
+}
+
+void StandardLogger::remove_sink(LogFunctions::LogFunction write) noexcept {
+  update_dispatch([&](Dispatch &next) {
+    std::erase_if(next.sinks,
+                  [&](const LogSink &sink) { return sink.write == write; });
+  });
+}
+
+template <typename Change>
+void StandardLogger::update_dispatch(const Change &change) noexcept {
+  auto &state = dispatch_snapshots<Dispatch>();
+  auto lock = std::scoped_lock(state.mutex);
+  auto next = *active_dispatch.load();
+  change(next);
+  next.deferred_levels = 0;
+  for (int level = 0; level < 5 && !next.sinks.empty(); ++level) {
+    auto deferred = std::ranges::all_of(next.sinks, [&](const LogSink &sink) {
+      return sink.accepts_deferred || !(sink.levels >> level & 1u);
+    });
+    next.deferred_levels |= static_cast<std::uint8_t>(deferred << level);
+  }
+
+  // Switching back and forth between configurations reuses their snapshots
+  const Dispatch *snapshot = &default_dispatch;
+  if (next != default_dispatch) {
+    auto found = std::ranges::find_if(
+        state.snapshots, [&](const auto &s) { return *s == next; });
+    if (found != state.snapshots.end()) {
+      snapshot = found->get();
+    } else {
+      state.snapshots.push_back(std::make_unique<Dispatch>(std::move(next)));
+      snapshot = state.snapshots.back().get();
+    }
+  }
+  active_dispatch.store(snapshot, std::memory_order_release);
+}
+
+void StandardLogger::set_level(LogLevel minimum) noexcept {
+  auto &registry = tag_registry();
+  auto lock = std::scoped_lock(registry.mutex);
+  minimum_level.store(minimum, std::memory_order_relaxed);
+  // Levels recorded by the backtrace must get past LoggerTraits' check too
+  auto levels = log_levels_from(minimum);
+  if (backtrace_enabled.load(std::memory_order_relaxed))
+    levels |= backtrace_levels;
+  enabled_levels.store(levels, std::memory_order_relaxed);
+  for (auto *tag = registry.head; tag; tag = tag->next)
+    tag->refresh(levels);
+}
+
+void StandardLogger::enable_backtrace(std::size_t lines) noexcept {
+  backtrace_lines.store(lines < 1 ? 1 : lines, std::memory_order_relaxed);
+  install_crash_handlers();
+  backtrace_enabled.store(true);
+  set_level(get_level());
+}
+
+void StandardLogger::disable_backtrace() noexcept {
+  backtrace_enabled.store(false);
+  set_level(get_level());
+}
+
+void StandardLogger::record_backtrace(LogLevel level,
+                                      std::string_view msg) noexcept {
+  if (!backtrace_owner.ring)
+    backtrace_owner.ring = acquire_ring();
+  auto &ring = *backtrace_owner.ring;
+  auto written = ring.written.load(std::memory_order_relaxed);
+  auto &entry = ring.entries[written % ring.capacity];
+  auto size = std::min(msg.size(), BacktraceEntry::text_capacity);
+  entry.level = level;
+  entry.size = static_cast<std::uint16_t>(size);
+  std::memcpy(entry.text.data(), msg.data(), size);
+  ring.written.store(written + 1, std::memory_order_release);
+}
+
+void StandardLogger::dump_backtrace(int fd) noexcept {
+  write_fd(fd, "----- backtrace (most recent messages last) -----\n");
+  for (auto *ring = backtrace_rings.load(std::memory_order_acquire); ring;
+       ring = ring->next) {
+    auto written = ring->written.load(std::memory_order_acquire);
+    if (written == 0)
+      continue;
+    auto count = std::min(written, ring->capacity);
+    for (auto i = written - count; i < written; ++i) {
+      const auto &entry = ring->entries[i % ring->capacity];
+      write_fd(fd, "[thread ");
+      write_number(fd, ring->thread_index);
+      write_fd(fd, entry.level == LogLevel::trace ? "] (trace) " : "] ");
+      write_fd(fd, std::string_view(entry.text.data(), entry.size));
+      write_fd(fd, "\n");
+    }
+  }
+  write_fd(fd, "----- end of backtrace -----\n");
+}
+
+void StandardLogger::detect_colors() noexcept {
+#if defined(_WIN32)
+  auto is_terminal = [](std::FILE *stream) {
+    return _isatty(_fileno(stream)) != 0;
+  };
+#else
+  auto is_terminal = [](std::FILE *stream) {
+    return isatty(fileno(stream)) != 0;
+  };
+#endif
+  auto stdout_colors = is_terminal(stdout);
+  auto stderr_colors = is_terminal(stderr);
+  for (std::size_t i = 0; i < active_styles.size(); ++i) {
+    auto colors = color_styles[i].use_stderr ? stderr_colors : stdout_colors;
+    active_styles[i] = colors ? color_styles[i] : plain_styles[i];
+  }
+}
+
+bool StandardLogger::start_async(const AsyncLogSettings &settings) noexcept {
+  static AsyncShutdown shutdown;
+  auto lock = std::scoped_lock(control_mutex);
+  if (writer.load())
+    return false;
+  writer.store(new AsyncWriter(settings));
+  async_enabled.store(true);
+  deferred_enabled.store(settings.deferred_formatting);
+  return true;
+}
+
+void StandardLogger::stop_async() noexcept {
+  auto lock = std::scoped_lock(control_mutex);
+  auto *current = writer.load();
+  if (!current)
+    return;
+  // Wait for producers that saw the backend enabled to finish pushing, so the
+  // writer's final drain does not miss their messages
+  async_enabled.store(false);
+  deferred_enabled.store(false);
+  while (in_flight.load() != 0)
+    std::this_thread::yield();
+  current->stop();
+  last_dropped = current->dropped();
+  writer.store(nullptr);
+  delete current;
+}
+
+std::size_t StandardLogger::dropped_messages() noexcept {
+  auto lock = std::scoped_lock(control_mutex);
+  auto *current = writer.load();
+  return current ? current->dropped() : last_dropped;
+}
+
+bool StandardLogger::enqueue_async(const LogRecord &record) noexcept {
+  auto message = QueuedMessage{.record = record};
+  message.record.message = {};
+  // Fields only live as long as the call, so they are rendered right away
+  message.record.fields = {};
+  if (record.fields.empty()) {
+    message.set_text(record.message);
+  } else {
+    auto text = std::string(record.message);
+    format_log_fields(record, text);
+    message.set_text(text);
+  }
+  return push_async(std::move(message), async_enabled);
+}
+
+bool StandardLogger::start_buffering(
+    const LogBufferSettings &settings) noexcept {
+  auto lock = std::scoped_lock(control_mutex);
+  if (buffering_enabled.load())
+    return false;
+  buffer_max_bytes.store(settings.max_bytes);
+  buffer_max_ticks.store(std::chrono::duration_cast<Clock::duration>(
+                             std::chrono::duration<double>(settings.max_delay))
+                             .count());
+  buffering_enabled.store(true);
+  return true;
+}
+
+void StandardLogger::stop_buffering() noexcept {
+  auto lock = std::scoped_lock(control_mutex);
+  buffering_enabled.store(false);
+  flush_line_buffers();
+}
+
+void StandardLogger::flush() noexcept {
+  {
+    auto lock = std::scoped_lock(control_mutex);
+    if (auto *current = writer.load())
+      current->flush();
+  }
+  flush_line_buffers();
+}
+
+bool StandardLogger::buffer_line(const LogRecord &record) noexcept {
+  if (record.level == LogLevel::fatal) {
+    flush_line_buffers();
+    return false;
+  }
+  thread_local LineBuffer buffer;
+  auto now = clock().now_ticks();
+  const auto &s = style(record.level);
+  auto header = LogHeaderBuffer{};
+  auto lock = std::scoped_lock(buffer.mutex);
+  auto &lines = s.use_stderr ? buffer.err : buffer.out;
+  if (buffer.out.empty() && buffer.err.empty())
+    buffer.oldest = now;
+  lines.append(format_log_header(record, header));
+  lines.append(s.prefix);
+  lines.append(record.message);
+  format_log_fields(record, lines);
+  lines.append(s.suffix);
+  lines.push_back('\n');
+  if (buffer.out.size() + buffer.err.size() >=
+          buffer_max_bytes.load(std::memory_order_relaxed) ||
+      now - buffer.oldest >= buffer_max_ticks.load(std::memory_order_relaxed)) {
+    write_batch(buffer.out, std::cout);
+    write_batch(buffer.err, std::cerr);
+  }
+  return true;
+}
+
+bool StandardLogger::defer(LogLevel level, const DeferredFormat &message,
+                           const std::source_location &location) noexcept {
+  // The same snapshot decides and dispatches, in case the functions change
+  const auto &current = current_dispatch();
+  const auto &functions = current.functions;
+  auto to_sinks = !current.sinks.empty();
+  if (to_sinks || functions.all || function_for(functions, level)) {
+    auto deferred_levels = current.deferred_levels >> static_cast<int>(level);
+    if (to_sinks ? !(deferred_levels & 1u) : !functions.accepts_deferred)
+      return false;
+    auto record = make_record(level, {}, location);
+    record.deferred = &message;
+    dispatch(current, record);
+    return true;
+  }
+  // Timestamp and thread are captured here, on the sending thread
+  return push_async(QueuedMessage{.record = make_record(level, {}, location),
+                                  .deferred = message},
+                    async_enabled);
+}
+} // namespace junco
\ No newline at end of file
@@ -0,0 +1,427 @@
+#include "junco/log_sinks.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define JC_HAS_MMAP
+#define JC_HAS_UNIX_SOCKETS
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace junco {
+namespace {
+// Labels written before each message, indexed by LogLevel
+constexpr std::array<std::string_view, 5> file_labels{
+    "(trace) ", "", "(warning) ", "(error) ", "(fatal) "};
+
+/**
+ * A single mapped file. Writers register themselves in `writers` while copying
+ * into `data`, so that the file is only unmapped once they are done.
+ */
+struct Mapping {
+  int fd = -1;
+  char *data = nullptr;
+  std::size_t capacity = 0;
+  std::atomic<std::size_t> cursor{0};
+  std::atomic<std::size_t> writers{0};
+};
+
+struct MappedFileState {
+  // Guards opening, closing and rotating
+  std::mutex mutex;
+  std::filesystem::path path;
+  MappedFileSettings settings;
+  std::atomic<Mapping *> current{nullptr};
+  // Retired mappings are kept alive, since writers may still hold a pointer
+  // to them (they will see that it is no longer current, and retry)
+  std::vector<std::unique_ptr<Mapping>> mappings;
+};
+MappedFileState &mapped_file() noexcept {
+  static MappedFileState state;
+  return state;
+}
+
+/**
+ * Closes the mapped file during static destruction if the user did not, so
+ * that it is still truncated to its contents.
+ */
+struct MappedFileShutdown {
+  ~MappedFileShutdown() { MappedFileSink::close(); }
+};
+
+/**
+ * The socket used by SocketSink. Like mappings, senders register themselves in
+ * `senders` while using `fd`, so that close() only closes it once they are
+ * done. The address and format are set before `fd` is published.
+ */
+struct SocketState {
+  // Guards opening and closing
+  std::mutex mutex;
+  std::atomic<int> fd{-1};
+  std::atomic<std::size_t> senders{0};
+  std::atomic<std::size_t> dropped{0};
+  LogFileFormat format = LogFileFormat::text;
+#ifdef JC_HAS_UNIX_SOCKETS
+  sockaddr_un address{};
+  socklen_t address_size = 0;
+#endif
+};
+SocketState &socket_state() noexcept {
+  static SocketState state;
+  return state;
+}
+
+/**
+ * Renders record in the given format and passes the pieces of its line to
+ * output, without joining them.
+ */
+void output_record(const LogRecord &record, LogFileFormat format,
+                   void (*output)(std::span<const std::string_view>)) noexcept {
+  if (format == LogFileFormat::json_lines) {
+    thread_local auto line = std::string{};
+    line.clear();
+    format_log_json(record, line);
+    auto parts = std::array<std::string_view, 2>{line, "\n"};
+    output(parts);
+    return;
+  }
+  auto header_buffer = LogHeaderBuffer{};
+  thread_local auto fields = std::string{};
+  fields.clear();
+  format_log_fields(record, fields);
+  auto parts = std::array<std::string_view, 5>{
+      format_log_header(record, header_buffer),
+      log_file_label(record.level), record.message,
+      fields, "\n"};
+  output(parts);
+}
+
+#ifdef JC_HAS_MMAP
+std::unique_ptr<Mapping> map_file(const std::filesystem::path &path,
+                                  std::size_t capacity) noexcept {
+  auto fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    return nullptr;
+  if (::ftruncate(fd, static_cast<off_t>(capacity)) != 0) {
+    ::close(fd);
+    return nullptr;
+  }
+  auto *data = ::mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED,
+                      fd, 0);
+  if (data == MAP_FAILED) {
+    ::close(fd);
+    return nullptr;
+  }
+  auto mapping = std::make_unique<Mapping>();
+  mapping->fd = fd;
+  mapping->data = static_cast<char *>(data);
+  mapping->capacity = capacity;
+  return mapping;
+}
+
+/**
+ * Waits for in-progress writes, then unmaps the file and cuts it down to the
+ * bytes that were written.
+ */
+void unmap_file(Mapping &mapping, std::size_t used) noexcept {
+  while (mapping.writers.load() != 0)
+    std::this_thread::yield();
+  ::munmap(mapping.data, mapping.capacity);
+  [[maybe_unused]] auto result =
+      ::ftruncate(mapping.fd, static_cast<off_t>(used));
+  ::close(mapping.fd);
+  mapping.data = nullptr;
+}
+#endif
+
+/**
+ * Shifts path.1 ... path.(n-1) up by one and moves path to path.1.
+ */
+void rotate_files(const std::filesystem::path &path,
+                  std::size_t max_files) noexcept {
+  auto ec = std::error_code{};
+  auto numbered = [&path](std::size_t i) {
+    auto rotated = path;
+    rotated += "." + std::to_string(i);
+    return rotated;
+  };
+  if (max_files == 0) {
+    std::filesystem::remove(path, ec);
+    return;
+  }
+  std::filesystem::remove(numbered(max_files), ec);
+  for (auto i = max_files; i > 1; --i)
+    std::filesystem::rename(numbered(i - 1), numbered(i), ec);
+  std::filesystem::rename(path, numbered(1), ec);
+}
+
+/**
+ * Replaces a full mapping with a new file. Only called by the writer whose
+ * reservation crossed the end of the mapping, and `used` is where that
+ * reservation began.
+ */
+void rotate(Mapping *full, std::size_t used) noexcept {
+#ifdef JC_HAS_MMAP
+  auto &state = mapped_file();
+  auto lock = std::scoped_lock(state.mutex);
+  if (state.current.load() != full)
+    return;
+  // The old mapping stays valid after its file is renamed
+  rotate_files(state.path, state.settings.max_files);
+  auto next = map_file(state.path, state.settings.capacity);
+  state.current.store(next.get());
+  if (next)
+    state.mappings.push_back(std::move(next));
+  unmap_file(*full, used);
+#else
+  (void)full;
+  (void)used;
+#endif
+}
+} // namespace
+
+std::string_view log_file_label(LogLevel level) noexcept {
+  return file_labels[static_cast<std::size_t>(level)];
+}
+
+bool MappedFileSink::open(const std::filesystem::path &path,
+                          const MappedFileSettings &settings) noexcept {
+#ifdef JC_HAS_MMAP
+  auto &state = mapped_file();
+  // Constructed after the state, so destroyed before it
+  static MappedFileShutdown shutdown;
+  auto lock = std::scoped_lock(state.mutex);
+  if (state.current.load())
+    return false;
+  auto mapping = map_file(path, settings.capacity);
+  if (!mapping)
+    return false;
+  state.path = path;
+  state.settings = settings;
+  state.current.store(mapping.get());
+  state.mappings.push_back(std::move(mapping));
+  return true;
+#else
+  (void)path;
+  (void)settings;
+  return false;
+#endif
+}
+
+void MappedFileSink::close() noexcept {
+#ifdef JC_HAS_MMAP
+  auto &state = mapped_file();
+  auto lock = std::scoped_lock(state.mutex);
+  auto *mapping = state.current.exchange(nullptr);
+  if (!mapping)
+    return;
+  auto used = std::min(mapping->cursor.load(), mapping->capacity);
+  unmap_file(*mapping, used);
+#endif
+}
+
+bool MappedFileSink::is_open() noexcept {
+  return mapped_file().current.load(std::memory_order_relaxed) != nullptr;
+}
+
+void MappedFileSink::write(const LogRecord &record) noexcept {
+  // Settings only change while the sink is closed
+  output_record(record, mapped_file().settings.format, append);
+}
+
+void MappedFileSink::append(std::span<const std::string_view> parts) noexcept {
+  auto &state = mapped_file();
+  auto size = std::size_t{0};
+  for (auto part : parts)
+    size += part.size();
+  for (;;) {
+    auto *mapping = state.current.load(std::memory_order_acquire);
+    if (!mapping || size > mapping->capacity)
+      return;
+
+    // Register before checking that the mapping is still current, so that
+    // rotate() cannot unmap it while this thread copies into it
+    mapping->writers.fetch_add(1);
+    if (state.current.load() != mapping) {
+      mapping->writers.fetch_sub(1);
+      continue;
+    }
+    auto start = mapping->cursor.fetch_add(size, std::memory_order_relaxed);
+    if (start + size <= mapping->capacity) {
+      auto *out = mapping->data + start;
+      for (auto part : parts) {
+        std::memcpy(out, part.data(), part.size());
+        out += part.size();
+      }
+      mapping->writers.fetch_sub(1, std::memory_order_release);
+      return;
+    }
+    mapping->writers.fetch_sub(1, std::memory_order_release);
+
+    // Exactly one reservation spans the end of the mapping; its owner rotates
+    // while everyone else waits for the new mapping
+    if (start <= mapping->capacity)
+      rotate(mapping, start);
+    else
+      while (state.current.load(std::memory_order_acquire) == mapping)
+        std::this_thread::yield();
+  }
+}
+
+bool SocketSink::open(const std::filesystem::path &path,
+                      LogFileFormat format) noexcept {
+#ifdef JC_HAS_UNIX_SOCKETS
+  auto &state = socket_state();
+  auto lock = std::scoped_lock(state.mutex);
+  const auto &native = path.native();
+  if (state.fd.load() >= 0 || native.size() >= sizeof(state.address.sun_path))
+    return false;
+  auto fd = ::socket(AF_UNIX, SOCK_DGRAM, 0);
+  if (fd < 0)
+    return false;
+  ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+  if (::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK) != 0) {
+    ::close(fd);
+    return false;
+  }
+  state.address = sockaddr_un{};
+  state.address.sun_family = AF_UNIX;
+  std::memcpy(state.address.sun_path, native.c_str(), native.size() + 1);
+  state.address_size = static_cast<socklen_t>(
+      offsetof(sockaddr_un, sun_path) + native.size() + 1);
+  state.format = format;
+  state.dropped.store(0);
+  state.fd.store(fd);
+  return true;
+#else
+  (void)path;
+  (void)format;
+  return false;
+#endif
+}
+
+void SocketSink::close() noexcept {
+#ifdef JC_HAS_UNIX_SOCKETS
+  auto &state = socket_state();
+  auto lock = std::scoped_lock(state.mutex);
+  auto fd = state.fd.exchange(-1);
+  if (fd < 0)
+    return;
+  while (state.senders.load() != 0)
+    std::this_thread::yield();
+  ::close(fd);
+#endif
+}
+
+bool SocketSink::is_open() noexcept {
+  return socket_state().fd.load(std::memory_order_relaxed) >= 0;
+}
+
+std::size_t SocketSink::dropped_records() noexcept {
+  return socket_state().dropped.load(std::memory_order_relaxed);
+}
+
+void SocketSink::write(const LogRecord &record) noexcept {
+  auto &state = socket_state();
+  if (state.fd.load(std::memory_order_relaxed) < 0)
+    return;
+  output_record(record, state.format, send);
+}
+
+void SocketSink::send(std::span<const std::string_view> parts) noexcept {
+#ifdef JC_HAS_UNIX_SOCKETS
+  auto &state = socket_state();
+  // Register before loading the socket, so that close() waits for this send
+  state.senders.fetch_add(1);
+  auto fd = state.fd.load();
+  if (fd >= 0) {
+    auto vectors = std::array<iovec, 5>{};
+    auto count = std::min(parts.size(), vectors.size());
+    for (std::size_t i = 0; i < count; ++i) {
+      vectors[i].iov_base = const_cast<char *>(parts[i].data());
+      vectors[i].iov_len = parts[i].size();
+    }
+    auto message = msghdr{};
+    message.msg_name = &state.address;
+    message.msg_namelen = state.address_size;
+    message.msg_iov = vectors.data();
+    message.msg_iovlen = static_cast<decltype(message.msg_iovlen)>(count);
+    // A full receive queue (EAGAIN/ENOBUFS), a missing receiver (ENOENT,
+    // ECONNREFUSED) and oversized records (EMSGSIZE) all end up here
+    if (::sendmsg(fd, &message, 0) < 0)
+      state.dropped.fetch_add(1, std::memory_order_relaxed);
+  }
+  state.senders.fetch_sub(1, std::memory_order_release);
+#else
+  (void)parts;
+#endif
+}
+
+LogSocketReceiver::LogSocketReceiver(const std::filesystem::path &path) noexcept
+    : path(path) {
+#ifdef JC_HAS_UNIX_SOCKETS
+  const auto &native = path.native();
+  auto address = sockaddr_un{};
+  if (native.size() >= sizeof(address.sun_path))
+    return;
+  address.sun_family = AF_UNIX;
+  std::memcpy(address.sun_path, native.c_str(), native.size() + 1);
+  fd = ::socket(AF_UNIX, SOCK_DGRAM, 0);
+  if (fd < 0)
+    return;
+  ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+  ::unlink(native.c_str());
+  if (::bind(fd, reinterpret_cast<const sockaddr *>(&address),
+             sizeof(address)) != 0) {
+    ::close(fd);
+    fd = -1;
+  }
+#endif
+}
+
+LogSocketReceiver::~LogSocketReceiver() {
+#ifdef JC_HAS_UNIX_SOCKETS
+  if (fd < 0)
+    return;
+  ::close(fd);
+  ::unlink(path.c_str());
+#endif
+}
+
+bool LogSocketReceiver::receive(std::string &record, double timeout) noexcept {
+#ifdef JC_HAS_UNIX_SOCKETS
+  if (fd < 0)
+    return false;
+  auto request = pollfd{.fd = fd, .events = POLLIN, .revents = 0};
+  if (::poll(&request, 1, static_cast<int>(timeout * 1000)) <= 0)
+    return false;
+  record.resize(max_record_size);
+  auto size = ::recv(fd, record.data(), record.size(), 0);
+  if (size < 0) {
+    record.clear();
+    return false;
+  }
+  record.resize(static_cast<std::size_t>(size));
+  return true;
+#else
+  (void)record;
+  (void)timeout;
+  return false;
+#endif
+}
+} // namespace junco
\ No newline at end of file
@@ -0,0 +1,520 @@
+#include "junco/profiler.hpp"
+#include "junco/log.hpp"
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace junco {
+namespace {
+static_assert((Profiler::buffer_capacity & (Profiler::buffer_capacity - 1)) ==
+                  0,
+              "the buffer capacity must be a power of two");
+
+/**
+ * Entering (if name is set) or leaving (if not) a zone, at ticks of TscClock.
+ */
+struct ZoneEvent {
+  const char *name;
+  TscClock::rep ticks;
+};
+
+/**
+ * A zone which was entered, but not left, as of the last event collected.
+ */
+struct OpenZone {
+  const char *name;
+  TscClock::rep start;
+  // Index of the zone's node in the frame being collected
+  std::uint32_t node;
+};
+
+/**
+ * The events recorded by one thread, in a single-producer, single-consumer
+ * ring buffer. Its thread writes events and moves head; end_frame() reads them
+ * and moves tail, with the registry locked.
+ */
+struct ThreadProfile {
+  // Written by the recording thread
+  alignas(64) std::atomic<std::size_t> head{0};
+  // Last value of tail seen by the recording thread
+  std::size_t cached_tail = 0;
+  // Zones entered and not yet left
+  std::size_t depth = 0;
+  // Depth of the outermost zone being dropped, or 0 if none
+  std::size_t skip_depth = 0;
+  std::atomic<std::size_t> dropped{0};
+  // Set when the recording thread exits; the buffer is then reused by the
+  // next new thread, once every event in it has been collected
+  std::atomic<bool> retired{false};
+
+  // Written by end_frame()
+  alignas(64) std::atomic<std::size_t> tail{0};
+  std::uint32_t thread = 0;
+  std::vector<OpenZone> open;
+  // First and last zones without a parent in the frame being collected
+  std::uint32_t first_root = ProfileNode::no_parent;
+  std::uint32_t last_root = ProfileNode::no_parent;
+
+  std::array<ZoneEvent, Profiler::buffer_capacity> events;
+};
+
+/**
+ * Links between the nodes of the frame being collected, in the order they
+ * were created.
+ */
+struct NodeLinks {
+  std::uint32_t first_child = ProfileNode::no_parent;
+  std::uint32_t last_child = ProfileNode::no_parent;
+  std::uint32_t next_sibling = ProfileNode::no_parent;
+};
+
+/**
+ * A zone call, as written to a trace.
+ */
+struct TraceZone {
+  const char *name;
+  std::uint32_t thread;
+  TscClock::rep start;
+  TscClock::rep end;
+};
+
+/**
+ * The zone calls that ended during a frame.
+ */
+struct TraceBatch {
+  std::vector<TraceZone> zones;
+  std::uint64_t frame;
+  TscClock::rep end;
+};
+
+// Frames end_frame() can get ahead of the trace writer before waiting for it
+constexpr std::size_t max_queued_batches = 64;
+
+/**
+ * Formats and writes the batches of a trace, on its own thread.
+ */
+struct TraceWriter {
+  std::mutex mutex;
+  std::condition_variable changed;
+  std::deque<TraceBatch> queue;
+  // Vectors of written batches, reused for the next ones
+  std::vector<std::vector<TraceZone>> spare;
+  bool running = false;
+  std::thread thread;
+
+  // Only used by the writer thread while running
+  std::ofstream file;
+  TscClock::rep origin = 0;
+  std::size_t events = 0;
+  std::vector<bool> named_threads;
+
+  void run() noexcept {
+    auto text = std::string();
+    auto lock = std::unique_lock(mutex);
+    for (;;) {
+      changed.wait(lock, [this] { return !queue.empty() || !running; });
+      if (queue.empty())
+        return;
+      auto batch = std::move(queue.front());
+      queue.pop_front();
+      lock.unlock();
+
+      text.clear();
+      format_batch(batch, text);
+      file.write(text.data(), static_cast<std::streamsize>(text.size()));
+
+      lock.lock();
+      batch.zones.clear();
+      spare.push_back(std::move(batch.zones));
+      changed.notify_all();
+    }
+  }
+
+  // Appends the separator before an event
+  void next_event(std::string &text) noexcept {
+    if (events++ != 0)
+      text.append(",\n");
+  }
+
+  // Returns the microseconds from the start of the trace to ticks
+  double microseconds(TscClock::rep ticks) const noexcept {
+    return static_cast<double>(ticks - origin) / 1000.0;
+  }
+
+  void format_batch(const TraceBatch &batch, std::string &text) noexcept {
+    auto out = std::back_inserter(text);
+    for (const auto &zone : batch.zones) {
+      // Each thread's track is named the first time it is used
+      if (zone.thread >= named_threads.size())
+        named_threads.resize(zone.thread + 1);
+      if (!named_threads[zone.thread]) {
+        named_threads[zone.thread] = true;
+        next_event(text);
+        std::format_to(out,
+                       R"({{"name":"thread_name","ph":"M","pid":1,"tid":{},)"
+                       R"("args":{{"name":"T{}"}}}})",
+                       zone.thread, zone.thread);
+      }
+      next_event(text);
+      text.append(R"({"name":)");
+      append_json_string(zone.name, text);
+      std::format_to(out,
+                     R"(,"cat":"zone","ph":"X","ts":{:.3f},"dur":{:.3f},)"
+                     R"("pid":1,"tid":{}}})",
+                     microseconds(zone.start),
+                     static_cast<double>(zone.end - zone.start) / 1000.0,
+                     zone.thread);
+    }
+    next_event(text);
+    std::format_to(out,
+                   R"({{"name":"frame {}","ph":"i","s":"g","ts":{:.3f},)"
+                   R"("pid":1,"tid":0}})",
+                   batch.frame, microseconds(batch.end));
+  }
+};
+
+struct ProfileRegistry {
+  std::mutex mutex;
+  std::vector<std::unique_ptr<ThreadProfile>> threads;
+  std::uint32_t next_thread = 0;
+  std::uint64_t frames = 0;
+  TscClock::time_point frame_start = TscClock::now();
+  ProfileFrame frame;
+  // Nodes of the frame being collected, before being sorted depth-first
+  std::vector<ProfileNode> nodes;
+  std::vector<NodeLinks> links;
+  // Used while sorting nodes
+  std::vector<std::uint32_t> stack;
+  std::vector<std::uint32_t> parents;
+  // Zone calls collected for the trace being captured, if any
+  bool tracing = false;
+  std::vector<TraceZone> trace_zones;
+  TraceWriter writer;
+};
+ProfileRegistry &registry() noexcept {
+  static ProfileRegistry instance;
+  return instance;
+}
+
+/**
+ * Stops the trace during static destruction if the user did not, so that its
+ * writer thread is joined and the file is completed.
+ */
+struct TraceShutdown {
+  ~TraceShutdown() { ProfileTrace::stop(); }
+};
+
+/**
+ * Returns a buffer for the calling thread, reusing one left by a thread that
+ * has exited if possible.
+ */
+ThreadProfile *acquire_profile() noexcept {
+  auto &profiles = registry();
+  auto lock = std::scoped_lock(profiles.mutex);
+  ThreadProfile *profile = nullptr;
+  for (auto &candidate : profiles.threads) {
+    if (candidate->retired.load(std::memory_order_acquire) &&
+        candidate->open.empty() &&
+        candidate->head.load(std::memory_order_relaxed) ==
+            candidate->tail.load(std::memory_order_relaxed)) {
+      profile = candidate.get();
+      profile->depth = 0;
+      profile->skip_depth = 0;
+      profile->retired.store(false, std::memory_order_relaxed);
+      break;
+    }
+  }
+  if (!profile)
+    profile = profiles.threads.emplace_back(new ThreadProfile).get();
+  profile->thread = profiles.next_thread++;
+  return profile;
+}
+
+/**
+ * The calling thread's buffer, acquired when it first enters a zone.
+ */
+struct ProfileRecorder {
+  ~ProfileRecorder() {
+    if (profile)
+      profile->retired.store(true, std::memory_order_release);
+  }
+  ThreadProfile *profile = nullptr;
+};
+thread_local ProfileRecorder recorder;
+
+ThreadProfile &this_thread_profile() noexcept {
+  if (!recorder.profile)
+    recorder.profile = acquire_profile();
+  return *recorder.profile;
+}
+
+/**
+ * Returns the node of the zone called name under parent (or under the roots
+ * of profile, if parent is no_parent), creating it if needed.
+ */
+std::uint32_t find_node(ProfileRegistry &profiles, ThreadProfile &profile,
+                        std::uint32_t parent, const char *name) noexcept {
+  auto first = parent == ProfileNode::no_parent
+                   ? profile.first_root
+                   : profiles.links[parent].first_child;
+  for (auto node = first; node != ProfileNode::no_parent;
+       node = profiles.links[node].next_sibling) {
+    auto *other = profiles.nodes[node].name;
+    if (other == name || std::strcmp(other, name) == 0)
+      return node;
+  }
+
+  auto node = static_cast<std::uint32_t>(profiles.nodes.size());
+  profiles.nodes.push_back(ProfileNode{.name = name,
+                                       .parent = parent,
+                                       .depth = 0,
+                                       .thread = profile.thread,
+                                       .calls = 0,
+                                       .total = {}});
+  profiles.links.emplace_back();
+  auto &last = parent == ProfileNode::no_parent
+                   ? profile.last_root
+                   : profiles.links[parent].last_child;
+  if (last != ProfileNode::no_parent)
+    profiles.links[last].next_sibling = node;
+  else if (parent == ProfileNode::no_parent)
+    profile.first_root = node;
+  else
+    profiles.links[parent].first_child = node;
+  last = node;
+  return node;
+}
+
+/**
+ * Adds the events recorded by profile since the last frame to the nodes being
+ * collected.
+ */
+void collect(ProfileRegistry &profiles, ThreadProfile &profile) noexcept {
+  profile.first_root = ProfileNode::no_parent;
+  profile.last_root = ProfileNode::no_parent;
+  // Zones left open by the last frame keep their place in the tree
+  auto enclosing = ProfileNode::no_parent;
+  for (auto &zone : profile.open) {
+    zone.node = find_node(profiles, profile, enclosing, zone.name);
+    enclosing = zone.node;
+  }
+
+  auto tail = profile.tail.load(std::memory_order_relaxed);
+  auto head = profile.head.load(std::memory_order_acquire);
+  for (; tail != head; ++tail) {
+    const auto &event = profile.events[tail % Profiler::buffer_capacity];
+    if (event.name) {
+      auto parent = profile.open.empty() ? ProfileNode::no_parent
+                                         : profile.open.back().node;
+      profile.open.push_back(OpenZone{
+          .name = event.name,
+          .start = event.ticks,
+          .node = find_node(profiles, profile, parent, event.name)});
+    } else if (!profile.open.empty()) {
+      const auto &zone = profile.open.back();
+      auto &node = profiles.nodes[zone.node];
+      ++node.calls;
+      node.total += TscClock::duration(event.ticks - zone.start);
+      if (profiles.tracing) {
+        profiles.trace_zones.push_back(TraceZone{.name = zone.name,
+                                                 .thread = profile.thread,
+                                                 .start = zone.start,
+                                                 .end = event.ticks});
+      }
+      profile.open.pop_back();
+    }
+  }
+  profile.tail.store(tail, std::memory_order_release);
+}
+
+/**
+ * Hands the zone calls collected during frame to the trace writer, waiting if
+ * it has fallen too far behind.
+ */
+void send_trace_batch(ProfileRegistry &profiles,
+                      const ProfileFrame &frame) noexcept {
+  auto &writer = profiles.writer;
+  auto batch = TraceBatch{.zones = {},
+                          .frame = frame.number,
+                          .end = frame.end.time_since_epoch().count()};
+  std::swap(batch.zones, profiles.trace_zones);
+  auto lock = std::unique_lock(writer.mutex);
+  writer.changed.wait(
+      lock, [&writer] { return writer.queue.size() < max_queued_batches; });
+  writer.queue.push_back(std::move(batch));
+  if (!writer.spare.empty()) {
+    profiles.trace_zones = std::move(writer.spare.back());
+    writer.spare.pop_back();
+  }
+  writer.changed.notify_all();
+}
+
+/**
+ * Appends the nodes of profile to frame, in depth-first order.
+ */
+void sort_nodes(ProfileRegistry &profiles, const ThreadProfile &profile,
+                ProfileFrame &frame) noexcept {
+  // Each entry of the stack is the next node to visit at its depth
+  auto &stack = profiles.stack;
+  auto &parents = profiles.parents;
+  stack.assign(1, profile.first_root);
+  parents.clear();
+  while (!stack.empty()) {
+    auto node = stack.back();
+    if (node == ProfileNode::no_parent) {
+      stack.pop_back();
+      if (!parents.empty())
+        parents.pop_back();
+      continue;
+    }
+    stack.back() = profiles.links[node].next_sibling;
+    auto sorted = profiles.nodes[node];
+    sorted.parent = parents.empty() ? ProfileNode::no_parent : parents.back();
+    sorted.depth = static_cast<std::uint32_t>(parents.size());
+    parents.push_back(static_cast<std::uint32_t>(frame.nodes.size()));
+    frame.nodes.push_back(sorted);
+    stack.push_back(profiles.links[node].first_child);
+  }
+}
+} // namespace
+
+void Profiler::begin_zone(const char *name) noexcept {
+  auto &profile = this_thread_profile();
+  ++profile.depth;
+  if (profile.skip_depth != 0) {
+    profile.dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  // Leave room for this event and for leaving every open zone, so that zones
+  // which were entered can always be left
+  auto head = profile.head.load(std::memory_order_relaxed);
+  auto needed = profile.depth + 1;
+  if (head - profile.cached_tail + needed > buffer_capacity) {
+    profile.cached_tail = profile.tail.load(std::memory_order_acquire);
+    if (head - profile.cached_tail + needed > buffer_capacity) {
+      profile.skip_depth = profile.depth;
+      profile.dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+  }
+  profile.events[head % buffer_capacity] =
+      ZoneEvent{name, TscClock::now().time_since_epoch().count()};
+  profile.head.store(head + 1, std::memory_order_release);
+}
+
+void Profiler::end_zone() noexcept {
+  auto &profile = this_thread_profile();
+  if (profile.depth == 0)
+    return;
+  if (profile.skip_depth != 0) {
+    if (profile.depth == profile.skip_depth)
+      profile.skip_depth = 0;
+    --profile.depth;
+    return;
+  }
+  auto ticks = TscClock::now().time_since_epoch().count();
+  auto head = profile.head.load(std::memory_order_relaxed);
+  profile.events[head % buffer_capacity] = ZoneEvent{nullptr, ticks};
+  profile.head.store(head + 1, std::memory_order_release);
+  --profile.depth;
+}
+
+const ProfileFrame &Profiler::end_frame() noexcept {
+  auto &profiles = registry();
+  auto lock = std::scoped_lock(profiles.mutex);
+  auto &frame = profiles.frame;
+  auto now = TscClock::now();
+  frame.number = profiles.frames++;
+  frame.start = profiles.frame_start;
+  frame.end = now;
+  frame.dropped_zones = 0;
+  frame.nodes.clear();
+  profiles.frame_start = now;
+
+  profiles.nodes.clear();
+  profiles.links.clear();
+  for (auto &profile : profiles.threads) {
+    collect(profiles, *profile);
+    sort_nodes(profiles, *profile, frame);
+    frame.dropped_zones +=
+        profile->dropped.exchange(0, std::memory_order_relaxed);
+  }
+  if (profiles.tracing)
+    send_trace_batch(profiles, frame);
+  return frame;
+}
+
+bool ProfileTrace::start(const std::filesystem::path &path) noexcept {
+  auto &profiles = registry();
+  // Constructed after the registry, so destroyed before it
+  static TraceShutdown shutdown;
+  auto lock = std::scoped_lock(profiles.mutex);
+  auto &writer = profiles.writer;
+  if (profiles.tracing)
+    return false;
+  writer.file.open(path, std::ios::binary | std::ios::trunc);
+  if (!writer.file) {
+    writer.file.clear();
+    return false;
+  }
+  writer.file << R"({"traceEvents":[)" << '\n';
+  writer.origin = TscClock::now().time_since_epoch().count();
+  writer.events = 0;
+  writer.named_threads.clear();
+  writer.running = true;
+  writer.thread = std::thread([&writer] { writer.run(); });
+  profiles.tracing = true;
+  return true;
+}
+
+void ProfileTrace::stop() noexcept {
+  auto &profiles = registry();
+  auto lock = std::scoped_lock(profiles.mutex);
+  auto &writer = profiles.writer;
+  if (!profiles.tracing)
+    return;
+  profiles.tracing = false;
+  profiles.trace_zones.clear();
+  {
+    auto writer_lock = std::scoped_lock(writer.mutex);
+    writer.running = false;
+  }
+  writer.changed.notify_all();
+  writer.thread.join();
+  writer.file << '\n' << R"(],"displayTimeUnit":"ms"})" << '\n';
+  writer.file.close();
+}
+
+bool ProfileTrace::is_capturing() noexcept {
+  auto &profiles = registry();
+  auto lock = std::scoped_lock(profiles.mutex);
+  return profiles.tracing;
+}
+
+void format_profile_frame(const ProfileFrame &frame,
+                          std::string &out) noexcept {
+  auto thread = ProfileNode::no_parent;
+  for (const auto &node : frame.nodes) {
+    if (node.thread != thread) {
+      thread = node.thread;
+      std::format_to(std::back_inserter(out), "[T{}]\n", thread);
+    }
+    auto milliseconds =
+        std::chrono::duration<double, std::milli>(node.total).count();
+    std::format_to(std::back_inserter(out), "{:{}}{} {:.3f} ms ({} {})\n", "",
+                   2 * (node.depth + 1), node.name, milliseconds, node.calls,
+                   node.calls == 1 ? "call" : "calls");
+  }
+  if (frame.dropped_zones != 0)
+    std::format_to(std::back_inserter(out), "({} zones dropped)\n",
+                   frame.dropped_zones);
+}
+} // namespace junco
\ No newline at end of file
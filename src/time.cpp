@@ -1,17 +1,106 @@
 #include "junco/time.hpp"
 #include <chrono>
+#include <exception>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#if defined(_MSC_VER)
+#include <intrin.h> // __cpuid
+#else
+#include <cpuid.h> // __get_cpuid
+#endif
+#endif
 
 namespace junco {
-Clock::Clock() noexcept : start_time(chrono_clock::now()) {}
+namespace {
+const std::chrono::time_zone *find_time_zone() noexcept {
+  try {
+    return std::chrono::current_zone();
+  } catch (const std::exception &) {
+    return nullptr;
+  }
+}
+
+/**
+ * Whether the timestamp counter ticks at a constant rate, whatever the power
+ * state of the CPU, and can therefore measure time.
+ */
+bool counter_is_invariant() noexcept {
+#if defined(__x86_64__) || defined(_M_X64)
+  // CPUID leaf 0x80000007, EDX bit 8: invariant TSC
+#if defined(_MSC_VER)
+  int registers[4];
+  __cpuid(registers, 0x80000000);
+  if (static_cast<unsigned>(registers[0]) < 0x80000007u)
+    return false;
+  __cpuid(registers, 0x80000007);
+  return (registers[3] & (1 << 8)) != 0;
+#else
+  unsigned eax, ebx, ecx, edx;
+  return __get_cpuid(0x80000007u, &eax, &ebx, &ecx, &edx) &&
+         (edx & (1u << 8)) != 0;
+#endif
+#elif defined(JC_HAS_TSC)
+  // The ARM generic timer always ticks at a fixed frequency
+  return true;
+#else
+  return false;
+#endif
+}
+} // namespace
+
+TscClock::Calibration TscClock::calibrate() noexcept {
+  using nanoseconds = std::chrono::nanoseconds;
+  auto steady_nanoseconds = [] {
+    return std::chrono::duration_cast<nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  };
+  if (!counter_is_invariant())
+    return Calibration{.base_ticks = 0,
+                       .base_nanoseconds = 0,
+                       .nanoseconds_per_tick = 0};
+
+  // Count ticks over a few milliseconds of steady_clock time. Each end is
+  // taken as the middle of two steady_clock reads around the counter read.
+  constexpr auto sample_time = std::chrono::nanoseconds(5'000'000).count();
+  auto sample = [&](std::uint64_t &ticks) {
+    auto before = steady_nanoseconds();
+    ticks = read_counter();
+    return before + (steady_nanoseconds() - before) / 2;
+  };
+  std::uint64_t first_ticks, last_ticks;
+  auto first = sample(first_ticks);
+  while (steady_nanoseconds() - first < sample_time) {
+  }
+  auto last = sample(last_ticks);
+  auto ticks = static_cast<double>(last_ticks - first_ticks);
+  // Counters slower than 1 MHz would not be worth reading
+  if (last_ticks <= first_ticks || ticks < (last - first) / 1000.0)
+    return Calibration{.base_ticks = 0,
+                       .base_nanoseconds = 0,
+                       .nanoseconds_per_tick = 0};
+  return Calibration{.base_ticks = last_ticks,
+                     .base_nanoseconds = last,
+                     .nanoseconds_per_tick =
+                         static_cast<double>(last - first) / ticks};
+}
+
+LocalTimeZone::LocalTimeZone() noexcept : zone(find_time_zone()) {}
 
-double Clock::get_time() const noexcept {
-  auto duration = chrono_clock::now() - start_time;
-  return std::chrono::duration_cast<std::chrono::duration<double>>(duration)
-      .count();
+LocalTimeZone::LocalTimeZone(const LocalTimeZone &other) noexcept
+    : zone(other.zone.load()) {}
+
+LocalTimeZone &LocalTimeZone::operator=(const LocalTimeZone &other) noexcept {
+  if (this != &other) {
+    zone.store(other.zone.load());
+    clear_offset();
+  }
+  return *this;
 }
 
-Time Clock::get_local_time() const noexcept {
-  auto local_time = get_local_raw();
+Time LocalTimeZone::get_time(
+    std::chrono::system_clock::time_point utc) const noexcept {
+  auto local_time = to_local(utc);
   auto days = std::chrono::floor<std::chrono::days>(local_time);
   auto hms = std::chrono::hh_mm_ss(local_time - days);
   return Time{.hours = hms.hours(),
@@ -21,8 +110,9 @@ Time Clock::get_local_time() const noexcept {
                   std::chrono::duration_cast<std::chrono::milliseconds>(
                       hms.subseconds())};
 }
-Date Clock::get_local_date() const noexcept {
-  auto local_time = get_local_raw();
+Date LocalTimeZone::get_date(
+    std::chrono::system_clock::time_point utc) const noexcept {
+  auto local_time = to_local(utc);
   auto days = std::chrono::floor<std::chrono::days>(local_time);
   auto ymd = std::chrono::year_month_day(days);
   return Date{
@@ -33,23 +123,60 @@ Date Clock::get_local_date() const noexcept {
   };
 }
 
-Stopwatch::Stopwatch(const Clock &_clock) noexcept
-    : clock(_clock), start_time(0), is_started(false) {}
-Stopwatch::Stopwatch(const Stopwatch &other) noexcept
-    : clock(other.clock), start_time(0), is_started(false) {}
-
-void Stopwatch::start() noexcept {
-  is_started = true;
-  start_time = clock.get_time();
+void LocalTimeZone::refresh() noexcept {
+  zone.store(find_time_zone());
+  clear_offset();
 }
-double Stopwatch::get_time() noexcept {
-  return (is_started ? clock.get_time() - start_time : 0);
+
+void LocalTimeZone::clear_offset() noexcept {
+  // Wait for other writers to finish
+  auto version = offset_version.load();
+  while ((version & 1) ||
+         !offset_version.compare_exchange_weak(version, version + 1))
+    version = offset_version.load();
+  std::atomic_thread_fence(std::memory_order_release);
+  offset_end.store(offset_begin.load(std::memory_order_relaxed),
+                   std::memory_order_relaxed);
+  offset_version.store(version + 2, std::memory_order_release);
 }
-double Stopwatch::stop() noexcept {
-  auto time = get_time();
-  is_started = false;
-  return time;
+
+LocalTimeZone::local_time_point LocalTimeZone::to_local(
+    std::chrono::system_clock::time_point utc) const noexcept {
+  return local_time_point(utc.time_since_epoch() + utc_offset(utc));
 }
-bool Stopwatch::started() const noexcept { return is_started; }
 
+std::chrono::seconds LocalTimeZone::utc_offset(
+    std::chrono::system_clock::time_point utc) const noexcept {
+  auto now = std::chrono::floor<std::chrono::seconds>(utc)
+                 .time_since_epoch()
+                 .count();
+  auto version = offset_version.load(std::memory_order_acquire);
+  if (!(version & 1)) {
+    auto begin = offset_begin.load(std::memory_order_relaxed);
+    auto end = offset_end.load(std::memory_order_relaxed);
+    auto offset = offset_seconds.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (offset_version.load(std::memory_order_relaxed) == version &&
+        begin <= now && now < end)
+      return std::chrono::seconds(offset);
+  }
+
+  const auto *time_zone = zone.load();
+  if (!time_zone)
+    return std::chrono::seconds(0);
+  auto info = time_zone->get_info(utc);
+  // Only one thread fills the cache at a time; the others just use the offset
+  // they looked up
+  if (!(version & 1) &&
+      offset_version.compare_exchange_strong(version, version + 1)) {
+    std::atomic_thread_fence(std::memory_order_release);
+    offset_begin.store(info.begin.time_since_epoch().count(),
+                       std::memory_order_relaxed);
+    offset_end.store(info.end.time_since_epoch().count(),
+                     std::memory_order_relaxed);
+    offset_seconds.store(info.offset.count(), std::memory_order_relaxed);
+    offset_version.store(version + 2, std::memory_order_release);
+  }
+  return info.offset;
+}
 } // namespace junco
\ No newline at end of file
@@ -0,0 +1,220 @@
+#include "junco/binary_log.hpp"
+#include <array>
+#include <cstdlib>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include <thread>
+
+namespace {
+/**
+ * Decodes the binary log at path, returning its text.
+ */
+std::string decode(const std::filesystem::path &path,
+                   const junco::BinaryLogFilter &filter = {}) {
+  auto file = std::ifstream(path, std::ios::binary);
+  auto text = std::ostringstream();
+  EXPECT_TRUE(junco::decode_binary_log(file, text, filter));
+  return text.str();
+}
+} // namespace
+
+/**
+ * Records written in binary form should decode to the same text the default
+ * logger would have written, and each format string should be stored once.
+ */
+TEST(BinaryLogTests, RoundTrip) {
+  auto path = std::filesystem::temp_directory_path() / "junco_binary.jclog";
+  ASSERT_TRUE(junco::BinaryLogSink::open(path));
+  ASSERT_FALSE(junco::BinaryLogSink::open(path));
+  junco::StandardLogger::set_log_functions(junco::BinaryLogSink::functions());
+  for (int i = 0; i < 3; ++i)
+    junco::Log::warning("entity {} is {} ({:.1f}m away)", i, "stuck", 2.5);
+  junco::Log::standard("{{literal}} {1}{0} {0:#x}", 'a', 'b');
+  junco::StructuredLog::error("disk full", {{"free_bytes", 0}});
+  junco::StandardLogger::set_log_functions(junco::LogFunctions{});
+  junco::BinaryLogSink::close();
+
+  EXPECT_EQ(decode(path), "(warning) entity 0 is stuck (2.5m away)\n"
+                          "(warning) entity 1 is stuck (2.5m away)\n"
+                          "(warning) entity 2 is stuck (2.5m away)\n"
+                          "{literal} ba 0x61\n"
+                          "(error) disk full free_bytes=0\n");
+
+  auto file = std::ifstream(path, std::ios::binary);
+  auto contents = std::string(std::istreambuf_iterator<char>(file), {});
+  auto format = std::string_view("entity {} is {} ({:.1f}m away)");
+  auto first = contents.find(format);
+  ASSERT_NE(first, std::string::npos);
+  EXPECT_EQ(contents.find(format, first + 1), std::string::npos);
+  std::filesystem::remove(path);
+}
+
+/**
+ * The decoder should only render records matching its filter.
+ */
+TEST(BinaryLogTests, Filter) {
+  auto path = std::filesystem::temp_directory_path() / "junco_filter.jclog";
+  ASSERT_TRUE(junco::BinaryLogSink::open(path));
+  junco::StandardLogger::set_log_functions(junco::BinaryLogSink::functions());
+  junco::StandardLogger::set_record_options(
+      {.timestamps = true, .thread_ids = true});
+  junco::Log::standard("main {}", 1);
+  auto worker = std::uint32_t{};
+  std::thread([&worker] {
+    worker = junco::StandardLogger::thread_index();
+    junco::Log::error("worker {}", 2);
+  }).join();
+  junco::StandardLogger::set_record_options({});
+  junco::Log::error("untimed {}", 3);
+  junco::StandardLogger::set_log_functions(junco::LogFunctions{});
+  junco::BinaryLogSink::close();
+
+  auto errors = decode(path, {.minimum = junco::LogLevel::error});
+  EXPECT_EQ(errors.find("main"), std::string::npos);
+  EXPECT_NE(errors.find(std::format("[T{}] (error) worker 2\n", worker)),
+            std::string::npos);
+  EXPECT_NE(errors.find("(error) untimed 3\n"), std::string::npos);
+
+  auto by_thread = decode(path, {.thread = worker});
+  EXPECT_TRUE(by_thread.ends_with("(error) worker 2\n"));
+  EXPECT_EQ(by_thread.find('\n'), by_thread.size() - 1);
+
+  // Untimed records are skipped once a time range is given
+  auto timed = decode(path, {.from = 0.0});
+  EXPECT_NE(timed.find("main 1"), std::string::npos);
+  EXPECT_EQ(timed.find("untimed"), std::string::npos);
+  std::filesystem::remove(path);
+}
+
+/**
+ * Compressed logs should decode to the same text as uncompressed ones, and
+ * time ranges should still select the right records.
+ */
+TEST(BinaryLogTests, CompressedBlocks) {
+  auto path = std::filesystem::temp_directory_path() / "junco_blocks.jclog";
+  ASSERT_TRUE(junco::BinaryLogSink::open(
+      path, {.compress = true, .block_size = 1024}));
+  junco::StandardLogger::set_log_functions(junco::BinaryLogSink::functions());
+  junco::StandardLogger::set_record_options({.timestamps = true});
+  auto expected = std::string();
+  for (int i = 0; i < 500; ++i) {
+    junco::Log::warning("entity {} is {}", i, "early");
+    expected += std::format("(warning) entity {} is early\n", i);
+  }
+  auto boundary = junco::StandardLogger::clock().get_time();
+  for (int i = 0; i < 500; ++i) {
+    junco::Log::standard("late entity {:.1f}", i * 0.5);
+    expected += std::format("late entity {:.1f}\n", i * 0.5);
+  }
+  junco::StandardLogger::set_record_options({});
+  junco::StandardLogger::set_log_functions(junco::LogFunctions{});
+  junco::BinaryLogSink::close();
+  // Uncompressed, each record would take more space than its text
+  EXPECT_LT(std::filesystem::file_size(path), expected.size());
+
+  // Strip the timestamps, which differ on every run
+  auto strip = [](const std::string &text) {
+    auto stripped = std::string();
+    auto lines = std::istringstream(text);
+    for (auto line = std::string(); std::getline(lines, line);)
+      stripped += line.substr(line.find("] ") + 2) + "\n";
+    return stripped;
+  };
+  EXPECT_EQ(strip(decode(path)), expected);
+  auto late = strip(decode(path, {.from = boundary}));
+  EXPECT_EQ(late, expected.substr(expected.find("late entity")));
+  std::filesystem::remove(path);
+}
+
+/**
+ * Structured fields should be stored with their types, not as text, and
+ * decode to the text format_log_fields() renders.
+ */
+TEST(BinaryLogTests, StructuredFields) {
+  auto path = std::filesystem::temp_directory_path() / "junco_fields.jclog";
+  ASSERT_TRUE(junco::BinaryLogSink::open(path));
+  junco::StandardLogger::set_log_functions(junco::BinaryLogSink::functions());
+  junco::StructuredLog::warning("asset loaded", {{"name", "crate \"big\""},
+                                                 {"bytes", 4096u},
+                                                 {"offset", -12},
+                                                 {"scale", 0.5},
+                                                 {"cached", true}});
+  junco::Log::standard("no fields {}", 1);
+  junco::StandardLogger::set_log_functions(junco::LogFunctions{});
+  junco::BinaryLogSink::close();
+
+  EXPECT_EQ(decode(path), "(warning) asset loaded name=\"crate \\\"big\\\"\" "
+                          "bytes=4096 offset=-12 scale=0.5 cached=true\n"
+                          "no fields 1\n");
+  auto file = std::ifstream(path, std::ios::binary);
+  auto contents = std::string(std::istreambuf_iterator<char>(file), {});
+  EXPECT_EQ(contents.find("bytes="), std::string::npos);
+  std::filesystem::remove(path);
+}
+
+/**
+ * The decoder should reject input that is not a binary log of this version.
+ */
+TEST(BinaryLogTests, RejectsOtherFiles) {
+  auto text = std::istringstream("not a binary log");
+  auto out = std::ostringstream();
+  EXPECT_FALSE(junco::decode_binary_log(text, out));
+  EXPECT_TRUE(out.str().empty());
+
+  // Other versions of the format are laid out differently
+  auto header = std::string("JCBLOG");
+  header.push_back(2);
+  header.push_back(static_cast<char>(sizeof(std::size_t)));
+  auto byte_order = std::uint32_t{0x01020304};
+  auto period = std::array<std::uint64_t, 2>{1, 1000};
+  header.append(reinterpret_cast<const char *>(&byte_order), 4);
+  header.append(reinterpret_cast<const char *>(period.data()), 16);
+  auto old = std::istringstream(header);
+  EXPECT_FALSE(junco::decode_binary_log(old, out));
+}
+
+/**
+ * Messages with dynamic widths or precisions should be stored as text, and
+ * decode to the text they were formatted to.
+ */
+TEST(BinaryLogTests, DynamicWidths) {
+  auto path = std::filesystem::temp_directory_path() / "junco_widths.jclog";
+  ASSERT_TRUE(junco::BinaryLogSink::open(path));
+  junco::StandardLogger::set_log_functions(junco::BinaryLogSink::functions());
+  for (int width = 4; width < 6; ++width)
+    junco::Log::standard("[{:>{}}] [{:.{}f}] {{}}", 7, width, 0.125, 2);
+  junco::Log::standard("[{:>4}] {}", 7, "fixed");
+  junco::StandardLogger::set_log_functions(junco::LogFunctions{});
+  junco::BinaryLogSink::close();
+
+  EXPECT_EQ(decode(path), "[   7] [0.12] {}\n"
+                          "[    7] [0.12] {}\n"
+                          "[   7] fixed\n");
+  std::filesystem::remove(path);
+}
+
+/**
+ * A sink left open when the program exits should still write its buffered
+ * records, and stop its compression thread instead of aborting.
+ */
+TEST(BinaryLogTests, CloseAtExit) {
+  auto path = std::filesystem::temp_directory_path() / "junco_exit.jclog";
+  for (auto compress : {false, true}) {
+    EXPECT_EXIT(
+        {
+          if (!junco::BinaryLogSink::open(path, {.compress = compress}))
+            std::exit(1);
+          junco::BinaryLogSink::write(
+              junco::LogRecord{.message = "last words"});
+          std::exit(0);
+        },
+        testing::ExitedWithCode(0), "");
+    EXPECT_EQ(decode(path), "last words\n");
+  }
+  std::filesystem::remove(path);
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+#include "junco/compression.hpp"
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+
+namespace {
+/**
+ * Compresses and decompresses input, expecting to get it back.
+ */
+std::size_t round_trip(const std::string &input) {
+  auto compressed = std::string();
+  junco::compress_block(input, compressed);
+  auto output = std::string();
+  EXPECT_TRUE(junco::decompress_block(compressed, input.size(), output));
+  EXPECT_EQ(output, input);
+  return compressed.size();
+}
+} // namespace
+
+TEST(CompressionTests, Empty) {
+  EXPECT_EQ(round_trip(""), 1);
+  EXPECT_EQ(round_trip("short"), 6);
+}
+
+/**
+ * Repetitive text, like log lines, should shrink considerably, including long
+ * runs whose matches overlap themselves.
+ */
+TEST(CompressionTests, RepetitiveInput) {
+  auto lines = std::string();
+  for (int i = 0; i < 1000; ++i)
+    lines += "[T1] entity " + std::to_string(i) + " moved to zone 4\n";
+  EXPECT_LT(round_trip(lines), lines.size() / 4);
+  EXPECT_LT(round_trip(std::string(100000, 'a')), 1000);
+}
+
+TEST(CompressionTests, RandomInput) {
+  auto random = std::mt19937(42);
+  auto bytes = std::string(70000, '\0');
+  for (auto &byte : bytes)
+    byte = static_cast<char>(random());
+  // Incompressible data grows by a few bytes at most
+  EXPECT_LT(round_trip(bytes), bytes.size() + bytes.size() / 200 + 16);
+}
+
+/**
+ * Corrupt blocks, or blocks of the wrong size, should be rejected.
+ */
+TEST(CompressionTests, RejectsInvalidBlocks) {
+  auto compressed = std::string();
+  junco::compress_block(std::string(1000, 'x'), compressed);
+  auto output = std::string();
+  EXPECT_FALSE(junco::decompress_block(compressed, 999, output));
+  EXPECT_FALSE(junco::decompress_block(compressed, 1001, output));
+  EXPECT_FALSE(junco::decompress_block(
+      compressed.substr(0, compressed.size() - 1), 1000, output));
+  // A match reaching back before the start of the block
+  EXPECT_FALSE(junco::decompress_block(std::string("\x10" "a\x05\x00", 4), 5,
+                                       output));
+}
\ No newline at end of file
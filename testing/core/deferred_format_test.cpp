@@ -0,0 +1,61 @@
+#include "junco/deferred_format.hpp"
+#include <gtest/gtest.h>
+#include <string>
+
+TEST(DeferredFormatTests, Values) {
+  auto deferred = junco::DeferredFormat{};
+  ASSERT_TRUE(deferred.empty());
+  auto captured = deferred.capture<int, double, char, bool>(
+      "{} {:.2f} {} {}", 42, 16.666, 'x', true);
+  ASSERT_TRUE(captured);
+  ASSERT_FALSE(deferred.empty());
+  EXPECT_EQ(deferred.format(), "42 16.67 x true");
+}
+
+/**
+ * Strings must be copied, since the original may be gone by the time the
+ * message is formatted.
+ */
+TEST(DeferredFormatTests, StringsAreCopied) {
+  auto deferred = junco::DeferredFormat{};
+  {
+    auto temporary = std::string("temporary string");
+    const char *literal = "literal";
+    auto captured = deferred.capture<std::string, const char *>(
+        "[{}] [{:>8}]", temporary, literal);
+    ASSERT_TRUE(captured);
+    temporary.assign(temporary.size(), '?');
+  }
+  EXPECT_EQ(deferred.format(), "[temporary string] [ literal]");
+}
+
+TEST(DeferredFormatTests, Overflow) {
+  auto deferred = junco::DeferredFormat{};
+  auto large = std::string(junco::DeferredFormat::capacity, 'a');
+  ASSERT_FALSE(deferred.capture<std::string>("{}", large));
+  ASSERT_TRUE(deferred.empty());
+}
+
+/**
+ * Captures should describe their arguments, so that they can be decoded
+ * without the types they were made from.
+ */
+TEST(DeferredFormatTests, ArgumentTypes) {
+  auto deferred = junco::DeferredFormat{};
+  auto captured =
+      deferred.capture<int, unsigned char, double, const char *, void *>(
+          "{} {} {} {} {}", -1, 2, 0.5, "text", nullptr);
+  ASSERT_TRUE(captured);
+  using Type = junco::DeferredType;
+  auto types = deferred.types();
+  ASSERT_EQ(types.size(), 5);
+  EXPECT_EQ(types[0], Type::int32);
+  EXPECT_EQ(types[1], Type::uint8);
+  EXPECT_EQ(types[2], Type::float64);
+  EXPECT_EQ(types[3], Type::string);
+  EXPECT_EQ(types[4], Type::pointer);
+  EXPECT_EQ(deferred.arguments().size(),
+            sizeof(int) + 1 + sizeof(double) + sizeof(std::size_t) + 4 +
+                sizeof(void *));
+  EXPECT_EQ(deferred.get_format(), "{} {} {} {} {}");
+}
\ No newline at end of file
@@ -0,0 +1,167 @@
+#include "junco/log_sinks.hpp"
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace {
+/**
+ * Returns every line of the given files, in order.
+ */
+std::vector<std::string>
+read_lines(const std::vector<std::filesystem::path> &paths) {
+  auto lines = std::vector<std::string>();
+  for (const auto &path : paths) {
+    auto file = std::ifstream(path);
+    auto line = std::string();
+    while (std::getline(file, line))
+      lines.push_back(line);
+  }
+  return lines;
+}
+} // namespace
+
+/**
+ * Messages written to the mapped file should appear in it, and closing the
+ * sink should cut the file down to its contents.
+ */
+TEST(MappedFileSinkTests, WriteAndTruncate) {
+  auto path = std::filesystem::temp_directory_path() / "junco_mapped.log";
+  ASSERT_TRUE(junco::MappedFileSink::open(path, {.capacity = 4096}));
+  ASSERT_FALSE(junco::MappedFileSink::open(path));
+  junco::StandardLogger::set_log_functions(junco::MappedFileSink::functions());
+  junco::Log::standard("first message");
+  junco::Log::warning("second message {}", 2);
+  junco::StandardLogger::set_log_functions(junco::LogFunctions{});
+  junco::MappedFileSink::close();
+  ASSERT_FALSE(junco::MappedFileSink::is_open());
+
+  auto lines = read_lines({path});
+  ASSERT_EQ(lines.size(), 2);
+  EXPECT_EQ(lines[0], "first message");
+  EXPECT_EQ(lines[1], "(warning) second message 2");
+  auto expected_size = std::string("first message\n(warning) second message 2\n")
+                           .size();
+  EXPECT_EQ(std::filesystem::file_size(path), expected_size);
+  std::filesystem::remove(path);
+}
+
+/**
+ * In JSON lines format, every record should be written as one JSON object.
+ */
+TEST(MappedFileSinkTests, JsonLines) {
+  auto path = std::filesystem::temp_directory_path() / "junco_mapped.jsonl";
+  ASSERT_TRUE(junco::MappedFileSink::open(
+      path, {.capacity = 4096, .format = junco::LogFileFormat::json_lines}));
+  junco::StandardLogger::set_log_functions(junco::MappedFileSink::functions());
+  junco::StructuredLog::error("disk full", {{"free_bytes", 0}});
+  junco::StandardLogger::set_log_functions(junco::LogFunctions{});
+  junco::MappedFileSink::close();
+
+  auto lines = read_lines({path});
+  ASSERT_EQ(lines.size(), 1);
+  EXPECT_TRUE(lines[0].starts_with("{\"level\":\"error\","));
+  EXPECT_TRUE(lines[0].ends_with(
+      "\"message\":\"disk full\",\"fields\":{\"free_bytes\":0}}"));
+  std::filesystem::remove(path);
+}
+
+/**
+ * Several threads filling a small mapping should cause rotations without
+ * losing or tearing any message.
+ */
+TEST(MappedFileSinkTests, ConcurrentRotation) {
+  constexpr int thread_count = 4;
+  constexpr int messages_per_thread = 500;
+  auto path = std::filesystem::temp_directory_path() / "junco_rotated.log";
+  auto settings = junco::MappedFileSettings{.capacity = 8192, .max_files = 64};
+  ASSERT_TRUE(junco::MappedFileSink::open(path, settings));
+
+  auto threads = std::vector<std::thread>();
+  for (int t = 0; t < thread_count; ++t) {
+    threads.push_back(std::thread([t] {
+      for (int i = 0; i < messages_per_thread; ++i)
+        junco::MappedFileSink::write(junco::LogRecord{
+            .message = std::format("thread {} message {:04}", t, i)});
+    }));
+  }
+  for (auto &thread : threads)
+    thread.join();
+  junco::MappedFileSink::close();
+
+  auto paths = std::vector<std::filesystem::path>{path};
+  for (int i = 1; i <= 64; ++i) {
+    auto rotated = path;
+    rotated += "." + std::to_string(i);
+    if (std::filesystem::exists(rotated))
+      paths.push_back(rotated);
+  }
+  ASSERT_GT(paths.size(), 1);
+
+  auto lines = read_lines(paths);
+  EXPECT_EQ(lines.size(), thread_count * messages_per_thread);
+  for (const auto &line : lines)
+    EXPECT_TRUE(line.starts_with("thread ")) << line;
+  for (const auto &p : paths)
+    std::filesystem::remove(p);
+}
+
+/**
+ * A sink left open when the program exits should still be cut down to its
+ * contents.
+ */
+TEST(MappedFileSinkTests, TruncateAtExit) {
+  auto path = std::filesystem::temp_directory_path() / "junco_exit.log";
+  EXPECT_EXIT(
+      {
+        if (!junco::MappedFileSink::open(path, {.capacity = 4096}))
+          std::exit(1);
+        junco::MappedFileSink::write(junco::LogRecord{.message = "last words"});
+        std::exit(0);
+      },
+      testing::ExitedWithCode(0), "");
+  EXPECT_EQ(std::filesystem::file_size(path),
+            std::string_view("last words\n").size());
+  std::filesystem::remove(path);
+}
+
+/**
+ * Records sent through the socket sink should arrive one per datagram, and
+ * records nobody can receive should be dropped and counted.
+ */
+TEST(SocketSinkTests, StreamAndDrop) {
+  auto path = std::filesystem::temp_directory_path() / "junco_sink.sock";
+  auto receiver = std::make_unique<junco::LogSocketReceiver>(path);
+  ASSERT_TRUE(receiver->is_open());
+  ASSERT_TRUE(junco::SocketSink::open(path));
+  ASSERT_FALSE(junco::SocketSink::open(path));
+  junco::StandardLogger::set_log_functions(junco::SocketSink::functions());
+  junco::Log::standard("first message");
+  junco::Log::warning("second message {}", 2);
+
+  auto record = std::string();
+  ASSERT_TRUE(receiver->receive(record, 1.0));
+  EXPECT_EQ(record, "first message\n");
+  ASSERT_TRUE(receiver->receive(record, 1.0));
+  EXPECT_EQ(record, "(warning) second message 2\n");
+  EXPECT_FALSE(receiver->receive(record, 0.0));
+  EXPECT_EQ(junco::SocketSink::dropped_records(), 0);
+
+  // A receiver that stops reading fills up without slowing the logger down
+  for (int i = 0; i < 10000; ++i)
+    junco::Log::standard("message {}", i);
+  auto dropped = junco::SocketSink::dropped_records();
+  EXPECT_GT(dropped, 0);
+  EXPECT_LT(dropped, 10000);
+
+  receiver.reset();
+  junco::Log::standard("nobody is listening");
+  EXPECT_EQ(junco::SocketSink::dropped_records(), dropped + 1);
+  junco::StandardLogger::set_log_functions(junco::LogFunctions{});
+  junco::SocketSink::close();
+  EXPECT_FALSE(junco::SocketSink::is_open());
+}
\ No newline at end of file
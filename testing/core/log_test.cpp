@@ -1,9 +1,14 @@
 #include "junco/log.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdio>
 #include <format>
 #include <gtest/gtest.h>
 #include <sstream>
 #include <string>
 #include <thread>
+#include <vector>
 
 /**
  * Custom logger specialized for comparing the result of a log operation to an
@@ -11,16 +16,22 @@
  */
 class ComparisonLogger final {
 public:
-  static void trace(const std::string &msg) noexcept { check_message(msg); }
-  static void standard(const std::string &msg) noexcept { check_message(msg); }
-  static void warning(const std::string &msg) noexcept { check_message(msg); }
-  static void error(const std::string &msg) noexcept { check_message(msg); }
-  static void fatal(const std::string &msg) noexcept { check_message(msg); }
-  static void set_expected(const std::string &val) noexcept { expected = val; }
+  static void trace(std::string_view msg) noexcept { check_message(msg); }
+  static void standard(std::string_view msg) noexcept { check_message(msg); }
+  static void warning(std::string_view msg) noexcept { check_message(msg); }
+  static void error(std::string_view msg) noexcept { check_message(msg); }
+  static void fatal(std::string_view msg) noexcept { check_message(msg); }
+  static void record(const junco::LogRecord &record) noexcept {
+    check_message(record.message);
+  }
+  static void set_expected(const std::string &val) noexcept {
+    expected = val;
+    matched = false;
+  }
   static bool did_match() noexcept { return matched; }
 
 private:
-  static void check_message(const std::string &msg) {
+  static void check_message(std::string_view msg) {
     // std::cout << expected << " : " << msg << std::endl;
     matched = msg == expected;
   }
@@ -72,7 +83,7 @@ TEST(LogTesting, CustomMultipleArgs) {
  * Tests junco's default logger and its ability to redirect log functions.
  */
 TEST(LogTesting, DefaultFunctions) {
-  auto functions = junco::LogFunctions{.all = ComparisonLogger::standard};
+  auto functions = junco::LogFunctions{.all = ComparisonLogger::record};
   junco::StandardLogger::set_log_functions(functions);
   ComparisonLogger::set_expected(
       "this is a message sent through the comparison logger!");
@@ -132,4 +143,552 @@ TEST(LogTesting, DefaultLevelDemo) {
   junco::Log::warning("This is a warning!");
   junco::Log::error("This is an error!");
   junco::Log::fatal("This was a fatal error!");
+}
+
+/**
+ * Messages sent while the asynchronous backend is running should all be
+ * written once it is stopped.
+ */
+TEST(LogTesting, AsyncBackend) {
+  auto output_strm = std::stringstream{};
+  auto old_rdbuf = static_cast<std::streambuf *>(std::cout.rdbuf());
+  std::cout.rdbuf(output_strm.rdbuf());
+
+  ASSERT_TRUE(junco::StandardLogger::start_async());
+  ASSERT_FALSE(junco::StandardLogger::start_async());
+  auto threads = std::vector<std::thread>();
+  for (int t = 0; t < 4; ++t) {
+    threads.push_back(std::thread([t] {
+      for (int i = 0; i < 100; ++i)
+        junco::Log::standard("async {} {}", t, i);
+    }));
+  }
+  for (auto &thread : threads)
+    thread.join();
+  junco::StandardLogger::stop_async();
+  ASSERT_FALSE(junco::StandardLogger::is_async());
+
+  std::cout.rdbuf(old_rdbuf);
+
+  auto output_str = output_strm.str();
+  for (int t = 0; t < 4; ++t) {
+    for (int i = 0; i < 100; ++i) {
+      auto expected = std::format("async {} {}\n", t, i);
+      EXPECT_NE(output_str.find(expected), std::string::npos);
+    }
+  }
+  EXPECT_EQ(junco::StandardLogger::dropped_messages(), 0);
+}
+
+/**
+ * A tiny queue with the drop_newest policy should never block the caller.
+ */
+TEST(LogTesting, AsyncDropNewest) {
+  auto output_strm = std::stringstream{};
+  auto old_rdbuf = static_cast<std::streambuf *>(std::cout.rdbuf());
+  std::cout.rdbuf(output_strm.rdbuf());
+
+  auto settings = junco::AsyncLogSettings{
+      .capacity = 2, .overflow = junco::OverflowPolicy::drop_newest};
+  ASSERT_TRUE(junco::StandardLogger::start_async(settings));
+  for (int i = 0; i < 10000; ++i)
+    junco::Log::standard("message {}", i);
+  junco::StandardLogger::stop_async();
+
+  std::cout.rdbuf(old_rdbuf);
+
+  auto output_str = output_strm.str();
+  auto written = static_cast<std::size_t>(
+      std::count(output_str.begin(), output_str.end(), '\n'));
+  EXPECT_EQ(written + junco::StandardLogger::dropped_messages(), 10000);
+}
+
+/**
+ * With deferred formatting enabled, messages should be formatted on the writer
+ * thread, even after the original arguments have gone out of scope.
+ */
+TEST(LogTesting, AsyncDeferredFormatting) {
+  auto output_strm = std::stringstream{};
+  auto old_rdbuf = static_cast<std::streambuf *>(std::cout.rdbuf());
+  std::cout.rdbuf(output_strm.rdbuf());
+
+  ASSERT_TRUE(junco::StandardLogger::start_async(
+      junco::AsyncLogSettings{.deferred_formatting = true}));
+  ASSERT_TRUE(junco::StandardLogger::can_defer(junco::LogLevel::standard));
+  for (int i = 0; i < 10; ++i) {
+    auto name = std::string("entity_") + std::to_string(i);
+    junco::Log::standard("{} moved {:.1f} units", name, i * 1.5);
+  }
+  junco::StandardLogger::stop_async();
+
+  std::cout.rdbuf(old_rdbuf);
+
+  auto output_str = output_strm.str();
+  for (int i = 0; i < 10; ++i) {
+    auto expected = std::format("entity_{} moved {:.1f} units\n", i, i * 1.5);
+    EXPECT_NE(output_str.find(expected), std::string::npos);
+  }
+}
+
+/**
+ * The JC_LOG_* macros should only evaluate their arguments when their level is
+ * compiled in.
+ */
+TEST(LogTesting, CompiledLevelMacros) {
+  auto functions = junco::LogFunctions{.all = ComparisonLogger::record};
+  junco::StandardLogger::set_log_functions(functions);
+
+  int evaluated = 0;
+  auto next = [&evaluated] { return ++evaluated; };
+  ComparisonLogger::set_expected("1");
+  JC_LOG_TRACE("{}", next());
+  if constexpr (junco::log_level_compiled(junco::LogLevel::trace)) {
+    EXPECT_EQ(evaluated, 1);
+    EXPECT_TRUE(ComparisonLogger::did_match());
+  } else {
+    EXPECT_EQ(evaluated, 0);
+  }
+  JC_LOG_FATAL("{}", next());
+  EXPECT_EQ(evaluated,
+            junco::log_level_compiled(junco::LogLevel::trace) ? 2 : 1);
+
+  junco::StandardLogger::set_log_functions(junco::LogFunctions{});
+}
+
+/**
+ * Messages below the runtime threshold should be dropped before they are
+ * formatted.
+ */
+TEST(LogTesting, RuntimeLevel) {
+  auto functions = junco::LogFunctions{.all = ComparisonLogger::record};
+  junco::StandardLogger::set_log_functions(functions);
+  junco::StandardLogger::set_level(junco::LogLevel::warning);
+  ASSERT_FALSE(junco::StandardLogger::enabled(junco::LogLevel::standard));
+  ASSERT_TRUE(junco::StandardLogger::enabled(junco::LogLevel::error));
+
+  ComparisonLogger::set_expected("filtered");
+  junco::Log::standard("{}", "filtered");
+  EXPECT_FALSE(ComparisonLogger::did_match());
+  junco::Log::warning("{}", "filtered");
+  EXPECT_TRUE(ComparisonLogger::did_match());
+
+  junco::StandardLogger::set_level(junco::LogLevel::trace);
+  junco::StandardLogger::set_log_functions(junco::LogFunctions{});
+}
+
+/**
+ * Tags should filter by the stricter of their own and the global threshold.
+ */
+TEST(LogTesting, TagLevels) {
+  auto functions = junco::LogFunctions{.all = ComparisonLogger::record};
+  junco::StandardLogger::set_log_functions(functions);
+  auto physics = junco::LogTag("physics", junco::LogLevel::warning);
+  EXPECT_EQ(physics.name(), "physics");
+  EXPECT_FALSE(physics.enabled(junco::LogLevel::standard));
+  EXPECT_TRUE(physics.enabled(junco::LogLevel::warning));
+
+  ComparisonLogger::set_expected("tagged");
+  junco::Log::standard(physics, "tagged");
+  EXPECT_FALSE(ComparisonLogger::did_match());
+  junco::Log::warning(physics, "tagged");
+  EXPECT_TRUE(ComparisonLogger::did_match());
+
+  junco::StandardLogger::set_level(junco::LogLevel::error);
+  EXPECT_FALSE(physics.enabled(junco::LogLevel::warning));
+  physics.set_level(junco::LogLevel::trace);
+  EXPECT_FALSE(physics.enabled(junco::LogLevel::standard));
+  junco::StandardLogger::set_level(junco::LogLevel::trace);
+  EXPECT_TRUE(physics.enabled(junco::LogLevel::standard));
+
+  junco::StandardLogger::set_log_functions(junco::LogFunctions{});
+}
+
+/**
+ * Messages that do not fit in LoggerTraits' thread-local buffer should still
+ * be sent in full.
+ */
+TEST(LogTesting, CustomLongMessage) {
+  auto long_message = std::string(CompareLog::buffer_capacity * 2, 'x');
+  ComparisonLogger::set_expected(long_message);
+  CompareLog::standard("{}", long_message);
+  EXPECT_TRUE(ComparisonLogger::did_match());
+}
+
+/**
+ * Loggers that only accept std::string are still supported.
+ */
+class StringLogger final {
+public:
+  static void trace(const std::string &msg) noexcept { last = msg; }
+  static void standard(const std::string &msg) noexcept { last = msg; }
+  static void warning(const std::string &msg) noexcept { last = msg; }
+  static void error(const std::string &msg) noexcept { last = msg; }
+  static void fatal(const std::string &msg) noexcept { last = msg; }
+  inline static std::string last;
+};
+
+TEST(LogTesting, CustomStringLogger) {
+  static_assert(!junco::ViewLogger<StringLogger>);
+  junco::LoggerTraits<StringLogger>::warning("{} + {}", 1, 2);
+  EXPECT_EQ(StringLogger::last, "1 + 2");
+}
+
+/**
+ * The backtrace should keep the most recent messages, even ones filtered out
+ * by the runtime level, and dump them on request.
+ */
+TEST(LogTesting, Backtrace) {
+  auto functions = junco::LogFunctions{.all = ComparisonLogger::record};
+  junco::StandardLogger::set_log_functions(functions);
+  junco::StandardLogger::set_level(junco::LogLevel::error);
+  junco::StandardLogger::enable_backtrace(4);
+  ASSERT_TRUE(junco::StandardLogger::enabled(junco::LogLevel::trace));
+
+  ComparisonLogger::set_expected("recorded 9");
+  for (int i = 0; i < 10; ++i)
+    junco::Log::standard("recorded {}", i);
+  // Recorded, but not sent
+  EXPECT_FALSE(ComparisonLogger::did_match());
+
+  auto *file = std::tmpfile();
+  ASSERT_NE(file, nullptr);
+  junco::StandardLogger::dump_backtrace(fileno(file));
+  std::rewind(file);
+  auto dump = std::string();
+  auto buffer = std::array<char, 256>();
+  while (auto read = std::fread(buffer.data(), 1, buffer.size(), file))
+    dump.append(buffer.data(), read);
+  std::fclose(file);
+
+  EXPECT_EQ(dump.find("recorded 5\n"), std::string::npos);
+  for (int i = 6; i < 10; ++i)
+    EXPECT_NE(dump.find(std::format("recorded {}\n", i)), std::string::npos);
+
+  junco::StandardLogger::disable_backtrace();
+  junco::StandardLogger::set_level(junco::LogLevel::trace);
+  junco::StandardLogger::set_log_functions(junco::LogFunctions{});
+}
+
+/**
+ * Tags created while the backtrace is enabled should record the levels it
+ * keeps, even when they are filtered out by the runtime level.
+ */
+TEST(LogTesting, BacktraceNewTag) {
+  auto functions = junco::LogFunctions{.all = ComparisonLogger::record};
+  junco::StandardLogger::set_log_functions(functions);
+  junco::StandardLogger::set_level(junco::LogLevel::error);
+  junco::StandardLogger::enable_backtrace(4);
+  auto audio = junco::LogTag("audio");
+  ASSERT_TRUE(audio.enabled(junco::LogLevel::trace));
+  junco::Log::trace(audio, "mixer underrun");
+  audio.set_level(junco::LogLevel::standard);
+  EXPECT_TRUE(audio.enabled(junco::LogLevel::standard));
+  junco::Log::standard(audio, "stream restarted");
+
+  auto *file = std::tmpfile();
+  ASSERT_NE(file, nullptr);
+  junco::StandardLogger::dump_backtrace(fileno(file));
+  std::rewind(file);
+  auto dump = std::string();
+  auto buffer = std::array<char, 256>();
+  while (auto read = std::fread(buffer.data(), 1, buffer.size(), file))
+    dump.append(buffer.data(), read);
+  std::fclose(file);
+  EXPECT_NE(dump.find("mixer underrun\n"), std::string::npos);
+  EXPECT_NE(dump.find("stream restarted\n"), std::string::npos);
+
+  junco::StandardLogger::disable_backtrace();
+  EXPECT_FALSE(audio.enabled(junco::LogLevel::standard));
+  junco::StandardLogger::set_level(junco::LogLevel::trace);
+  junco::StandardLogger::set_log_functions(junco::LogFunctions{});
+}
+
+/**
+ * Records should carry the selected timestamp and thread information, which is
+ * only rendered by the sink.
+ */
+TEST(LogTesting, RecordInformation) {
+  static auto last = junco::LogRecord{};
+  static auto last_message = std::string();
+  auto remember = [](const junco::LogRecord &record) noexcept {
+    last = record;
+    last_message = record.message;
+  };
+  junco::StandardLogger::set_log_functions(
+      junco::LogFunctions{.all = remember});
+
+  junco::Log::warning("plain");
+  EXPECT_EQ(last_message, "plain");
+  EXPECT_EQ(last.level, junco::LogLevel::warning);
+  EXPECT_FALSE(last.has_timestamp);
+  EXPECT_FALSE(last.has_thread);
+
+  auto clock = junco::Clock();
+  junco::StandardLogger::set_clock(&clock);
+  junco::StandardLogger::set_record_options(
+      {.timestamps = true, .thread_ids = true});
+  auto before = clock.now_ticks();
+  junco::Log::standard("{}", 42);
+  EXPECT_EQ(last_message, "42");
+  ASSERT_TRUE(last.has_timestamp);
+  ASSERT_TRUE(last.has_thread);
+  EXPECT_GE(last.timestamp, before);
+  EXPECT_LE(last.timestamp, clock.now_ticks());
+  EXPECT_EQ(last.thread, junco::StandardLogger::thread_index());
+
+  auto other_thread = std::uint32_t{};
+  std::thread([&] {
+    junco::Log::standard("other");
+    other_thread = last.thread;
+  }).join();
+  EXPECT_NE(other_thread, junco::StandardLogger::thread_index());
+
+  auto buffer = junco::LogHeaderBuffer{};
+  auto record = junco::LogRecord{.has_timestamp = true,
+                                 .has_thread = true,
+                                 .thread = 3,
+                                 .timestamp = 0};
+  EXPECT_EQ(junco::format_log_header(record, buffer), "[    0.000000] [T3] ");
+
+  junco::StandardLogger::set_record_options({});
+  junco::StandardLogger::set_clock(nullptr);
+  junco::StandardLogger::set_log_functions(junco::LogFunctions{});
+}
+
+/**
+ * The call site of each message should reach the log functions, so that sinks
+ * can route messages by file.
+ */
+TEST(LogTesting, SourceLocation) {
+  static auto last_line = std::uint_least32_t{};
+  static auto last_file = std::string();
+  auto remember = [](const junco::LogRecord &record) noexcept {
+    last_line = record.location.line();
+    last_file = record.location.file_name();
+  };
+  junco::StandardLogger::set_log_functions(
+      junco::LogFunctions{.all = remember});
+
+  auto line = std::source_location::current().line() + 1;
+  junco::Log::warning("located {}", 1);
+  EXPECT_EQ(last_line, line);
+  EXPECT_TRUE(last_file.ends_with("log_test.cpp"));
+
+  line = std::source_location::current().line() + 1;
+  JC_LOG_ERROR("located by macro");
+  EXPECT_EQ(last_line, line);
+
+  junco::StandardLogger::error("direct");
+  EXPECT_EQ(last_line, 0u);
+
+  junco::StandardLogger::set_log_functions(junco::LogFunctions{});
+}
+
+/**
+ * Limited call sites should drop repeated and excess messages, and summarize
+ * what they dropped in front of the next message they send.
+ */
+TEST(LogTesting, RateLimitedSites) {
+  static auto sent = std::vector<std::string>();
+  auto remember = [](const junco::LogRecord &record) noexcept {
+    sent.emplace_back(record.message);
+  };
+  junco::StandardLogger::set_log_functions(
+      junco::LogFunctions{.all = remember});
+
+  auto collapsed = junco::LogSite({.collapse_repeats = true});
+  for (int i = 0; i < 5; ++i)
+    junco::Log::warning(collapsed, "entity {} has no mesh", 7);
+  junco::Log::warning(collapsed, "entity {} has no mesh", 8);
+  EXPECT_EQ(sent, (std::vector<std::string>{"entity 7 has no mesh",
+                                            "suppressed 4 similar messages",
+                                            "entity 8 has no mesh"}));
+
+  // The window may roll over once during the loop, letting through at most
+  // one more batch
+  sent.clear();
+  for (int i = 0; i < 100; ++i)
+    junco::Log::warning(JC_LOG_SITE(.per_second = 3), "flood {}", i);
+  EXPECT_GE(sent.size(), 3u);
+  EXPECT_LE(sent.size(), 7u);
+  EXPECT_EQ(sent.front(), "flood 0");
+
+  junco::StandardLogger::set_log_functions(junco::LogFunctions{});
+}
+
+/**
+ * Structured messages should reach log functions with their typed fields,
+ * which can be rendered as text or JSON.
+ */
+TEST(LogTesting, StructuredFields) {
+  static auto text = std::string();
+  static auto json = std::string();
+  static auto types = std::vector<junco::LogField::Type>();
+  auto remember = [](const junco::LogRecord &record) noexcept {
+    text = record.message;
+    junco::format_log_fields(record, text);
+    json.clear();
+    junco::format_log_json(record, json);
+    types.clear();
+    for (const auto &field : record.fields)
+      types.push_back(field.type());
+  };
+  junco::StandardLogger::set_log_functions(
+      junco::LogFunctions{.all = remember});
+
+  junco::StructuredLog::warning("slow frame", {{"entity", 42},
+                                               {"frame_ms", 16.5},
+                                               {"name", "crate \"B\""},
+                                               {"visible", true},
+                                               {"count", 3u}});
+  using Type = junco::LogField::Type;
+  EXPECT_EQ(types,
+            (std::vector<Type>{Type::signed_integer, Type::floating_point,
+                               Type::string, Type::boolean,
+                               Type::unsigned_integer}));
+  EXPECT_EQ(text, "slow frame entity=42 frame_ms=16.5 name=\"crate \\\"B\\\"\" "
+                  "visible=true count=3");
+  EXPECT_TRUE(json.starts_with("{\"level\":\"warning\",\"file\":\""));
+  EXPECT_TRUE(json.ends_with(
+      ",\"message\":\"slow frame\",\"fields\":{\"entity\":42,"
+      "\"frame_ms\":16.5,\"name\":\"crate \\\"B\\\"\",\"visible\":true,"
+      "\"count\":3}}"));
+
+  junco::StructuredLog::error("no fields");
+  EXPECT_EQ(text, "no fields");
+
+  junco::StandardLogger::set_log_functions(junco::LogFunctions{});
+}
+
+/**
+ * Buffered lines should only be written once a threshold is hit, on flush(),
+ * or when their thread exits.
+ */
+TEST(LogTesting, BufferedLines) {
+  auto output = std::ostringstream();
+  auto *original = std::cout.rdbuf(output.rdbuf());
+  ASSERT_TRUE(junco::StandardLogger::start_buffering(
+      {.max_bytes = 1024 * 1024, .max_delay = 3600}));
+  ASSERT_FALSE(junco::StandardLogger::start_buffering());
+
+  junco::Log::standard("first {}", 1);
+  junco::Log::standard("second {}", 2);
+  EXPECT_TRUE(output.str().empty());
+  junco::Log::flush();
+  EXPECT_EQ(output.str(), "first 1\nsecond 2\n");
+
+  std::thread([] { junco::Log::standard("from a thread"); }).join();
+  EXPECT_EQ(output.str(), "first 1\nsecond 2\nfrom a thread\n");
+  junco::StandardLogger::stop_buffering();
+
+  // A tiny size threshold writes every line right away
+  output.str("");
+  ASSERT_TRUE(junco::StandardLogger::start_buffering({.max_bytes = 1}));
+  junco::Log::standard("immediate");
+  EXPECT_EQ(output.str(), "immediate\n");
+  junco::StandardLogger::stop_buffering();
+  std::cout.rdbuf(original);
+}
+
+/**
+ * Plain styles keep the level labels, but drop every escape sequence.
+ */
+TEST(LogTesting, ColorStyles) {
+  using junco::LogLevel;
+  junco::StandardLogger::set_colors(false);
+  for (auto level : {LogLevel::trace, LogLevel::standard, LogLevel::warning,
+                     LogLevel::error, LogLevel::fatal}) {
+    const auto &style = junco::StandardLogger::style(level);
+    EXPECT_EQ(style.prefix.find('\033'), std::string_view::npos);
+    EXPECT_TRUE(style.suffix.empty());
+    EXPECT_EQ(style.use_stderr, level >= LogLevel::warning);
+  }
+  EXPECT_EQ(junco::StandardLogger::style(LogLevel::error).prefix, "(error) ");
+
+  junco::StandardLogger::set_colors(true);
+  EXPECT_EQ(junco::StandardLogger::style(LogLevel::error).prefix,
+            "\033[31m(error) ");
+  junco::StandardLogger::detect_colors();
+}
+
+/**
+ * Log functions can be replaced while other threads log, and every message
+ * reaches exactly one set of functions.
+ */
+TEST(LogTesting, SwapFunctionsWhileLogging) {
+  static std::atomic<int> first_count{0};
+  static std::atomic<int> second_count{0};
+  auto first = junco::LogFunctions{
+      .all = [](const junco::LogRecord &) { ++first_count; }};
+  auto second = junco::LogFunctions{
+      .all = [](const junco::LogRecord &) { ++second_count; }};
+  junco::StandardLogger::set_log_functions(first);
+
+  constexpr int messages = 20000;
+  auto done = std::atomic<bool>{false};
+  auto logger = std::thread([&done] {
+    for (int i = 0; i < messages; ++i)
+      junco::Log::standard("message {}", i);
+    done = true;
+  });
+  for (int swaps = 0; !done; ++swaps)
+    junco::StandardLogger::set_log_functions(swaps % 2 ? first : second);
+  logger.join();
+  junco::StandardLogger::set_log_functions(junco::LogFunctions{});
+
+  EXPECT_EQ(first_count + second_count, messages);
+}
+
+/**
+ * Each record should be formatted once and reach every sink whose levels
+ * include it.
+ */
+TEST(LogTesting, SinkFanOut) {
+  static std::vector<std::string> all_lines;
+  static std::vector<std::string> warning_lines;
+  static std::vector<const char *> buffers;
+  auto all = [](const junco::LogRecord &record) {
+    all_lines.emplace_back(record.message);
+    buffers.push_back(record.message.data());
+  };
+  auto warnings = [](const junco::LogRecord &record) {
+    warning_lines.emplace_back(record.message);
+    buffers.push_back(record.message.data());
+  };
+  auto output = std::ostringstream();
+  auto *original = std::cout.rdbuf(output.rdbuf());
+  junco::StandardLogger::add_sink({.write = all});
+  junco::StandardLogger::add_sink(
+      {.write = warnings,
+       .levels = junco::log_levels_from(junco::LogLevel::warning)});
+  // Only standard messages go to the console
+  junco::StandardLogger::add_sink(junco::StandardLogger::console_sink(
+      1u << static_cast<int>(junco::LogLevel::standard)));
+
+  junco::Log::standard("step {}", 1);
+  junco::Log::error("failed step {}", 2);
+  EXPECT_EQ(all_lines,
+            (std::vector<std::string>{"step 1", "failed step 2"}));
+  EXPECT_EQ(warning_lines, std::vector<std::string>{"failed step 2"});
+  ASSERT_EQ(buffers.size(), 3);
+  EXPECT_EQ(buffers[1], buffers[2]);
+  EXPECT_EQ(output.str(), "step 1\n");
+  EXPECT_FALSE(junco::StandardLogger::can_defer(junco::LogLevel::warning));
+
+  // Sinks take precedence over log functions until the last one is removed
+  junco::StandardLogger::set_log_functions(
+      junco::LogFunctions{.all = ComparisonLogger::record});
+  junco::StandardLogger::remove_sink(all);
+  junco::StandardLogger::remove_sink(warnings);
+  ComparisonLogger::set_expected("to the console");
+  junco::Log::standard("to the console");
+  EXPECT_FALSE(ComparisonLogger::did_match());
+  junco::StandardLogger::remove_sink(
+      junco::StandardLogger::console_sink().write);
+  ComparisonLogger::set_expected("to the functions");
+  junco::Log::standard("to the functions");
+  EXPECT_TRUE(ComparisonLogger::did_match());
+  EXPECT_EQ(output.str(), "step 1\nto the console\n");
+  junco::StandardLogger::set_log_functions(junco::LogFunctions{});
+  std::cout.rdbuf(original);
 }
\ No newline at end of file
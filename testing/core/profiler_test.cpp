@@ -0,0 +1,219 @@
+#include "junco/profiler.hpp"
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace {
+/**
+ * Returns the index of the first node called name, or -1.
+ */
+int find(const junco::ProfileFrame &frame, std::string_view name) {
+  for (std::size_t i = 0; i < frame.nodes.size(); ++i) {
+    if (frame.nodes[i].name == name)
+      return static_cast<int>(i);
+  }
+  return -1;
+}
+} // namespace
+
+/**
+ * Zones should be nested under the zones open when they were entered, with
+ * repeated calls from the same parent merged into one node.
+ */
+TEST(ProfilerTests, NestedZones) {
+  junco::Profiler::end_frame();
+  {
+    auto frame = junco::ProfileScope("frame");
+    for (int i = 0; i < 3; ++i) {
+      auto physics = junco::ProfileScope("physics");
+      auto collisions = junco::ProfileScope("collisions");
+    }
+    auto render = junco::ProfileScope("render");
+  }
+  const auto &frame = junco::Profiler::end_frame();
+  ASSERT_EQ(frame.nodes.size(), 4);
+  EXPECT_EQ(frame.dropped_zones, 0);
+
+  const auto &root = frame.nodes[0];
+  EXPECT_STREQ(root.name, "frame");
+  EXPECT_EQ(root.parent, junco::ProfileNode::no_parent);
+  EXPECT_EQ(root.calls, 1);
+  auto expected = {std::pair{"physics", 0}, {"collisions", 1}, {"render", 0}};
+  auto index = 1;
+  for (auto [name, parent] : expected) {
+    const auto &node = frame.nodes[index++];
+    EXPECT_STREQ(node.name, name);
+    EXPECT_EQ(node.parent, parent);
+    EXPECT_EQ(node.depth, frame.nodes[parent].depth + 1);
+    EXPECT_EQ(node.thread, root.thread);
+  }
+  EXPECT_EQ(frame.nodes[1].calls, 3);
+  EXPECT_EQ(frame.nodes[2].calls, 3);
+  EXPECT_EQ(frame.nodes[3].calls, 1);
+  EXPECT_GE(root.total, frame.nodes[1].total + frame.nodes[3].total);
+  EXPECT_GE(frame.nodes[1].total, frame.nodes[2].total);
+  EXPECT_LE(root.total, frame.get_duration());
+
+  auto text = std::string();
+  junco::format_profile_frame(frame, text);
+  EXPECT_NE(text.find("\n  frame "), std::string::npos);
+  EXPECT_NE(text.find("\n      collisions "), std::string::npos);
+  EXPECT_NE(text.find("ms (3 calls)\n"), std::string::npos);
+}
+
+/**
+ * A zone still open at the end of a frame should be counted in the frame
+ * during which it ends, with the zones nested in it.
+ */
+TEST(ProfilerTests, ZoneAcrossFrames) {
+  auto number = junco::Profiler::end_frame().number;
+  junco::Profiler::begin_zone("loading");
+  {
+    auto first = junco::ProfileScope("first chunk");
+  }
+  const auto &during = junco::Profiler::end_frame();
+  EXPECT_EQ(during.number, number + 1);
+  ASSERT_EQ(during.nodes.size(), 2);
+  EXPECT_EQ(during.nodes[0].calls, 0);
+  EXPECT_EQ(during.nodes[1].calls, 1);
+
+  {
+    auto second = junco::ProfileScope("second chunk");
+  }
+  junco::Profiler::end_zone();
+  const auto &after = junco::Profiler::end_frame();
+  ASSERT_EQ(after.nodes.size(), 2);
+  EXPECT_STREQ(after.nodes[0].name, "loading");
+  EXPECT_EQ(after.nodes[0].calls, 1);
+  EXPECT_STREQ(after.nodes[1].name, "second chunk");
+  EXPECT_EQ(after.nodes[1].parent, 0);
+}
+
+TEST(ProfilerTests, Threads) {
+  junco::Profiler::end_frame();
+  {
+    auto main = junco::ProfileScope("main");
+    std::thread([] { auto worker = junco::ProfileScope("worker"); }).join();
+  }
+  const auto &frame = junco::Profiler::end_frame();
+  auto main = find(frame, "main");
+  auto worker = find(frame, "worker");
+  ASSERT_NE(main, -1);
+  ASSERT_NE(worker, -1);
+  EXPECT_NE(frame.nodes[main].thread, frame.nodes[worker].thread);
+  EXPECT_EQ(frame.nodes[worker].parent, junco::ProfileNode::no_parent);
+}
+
+/**
+ * Once a thread's buffer is full, new zones should be dropped and counted,
+ * while zones already entered can still be left.
+ */
+TEST(ProfilerTests, FullBuffer) {
+  junco::Profiler::end_frame();
+  constexpr auto zones = junco::Profiler::buffer_capacity;
+  junco::Profiler::begin_zone("outer");
+  for (std::size_t i = 0; i < zones; ++i)
+    auto zone = junco::ProfileScope("zone");
+  junco::Profiler::end_zone();
+  const auto &frame = junco::Profiler::end_frame();
+  ASSERT_EQ(frame.nodes.size(), 2);
+  EXPECT_EQ(frame.nodes[0].calls, 1);
+  EXPECT_EQ(frame.nodes[1].calls + frame.dropped_zones, zones);
+  EXPECT_GT(frame.dropped_zones, 0);
+
+  {
+    auto zone = junco::ProfileScope("after");
+  }
+  const auto &next = junco::Profiler::end_frame();
+  EXPECT_EQ(next.dropped_zones, 0);
+  EXPECT_NE(find(next, "after"), -1);
+}
+
+/**
+ * A trace should contain every zone call as a complete event on its thread's
+ * track, and a marker for each frame.
+ */
+TEST(ProfilerTests, Trace) {
+  auto path = std::filesystem::temp_directory_path() / "junco_trace.json";
+  junco::Profiler::end_frame();
+  ASSERT_TRUE(junco::ProfileTrace::start(path));
+  ASSERT_FALSE(junco::ProfileTrace::start(path));
+  EXPECT_TRUE(junco::ProfileTrace::is_capturing());
+  auto frames = std::uint64_t{0};
+  for (int i = 0; i < 3; ++i) {
+    {
+      auto update = junco::ProfileScope("update \"quoted\"");
+      std::thread([] { auto job = junco::ProfileScope("job"); }).join();
+    }
+    frames = junco::Profiler::end_frame().number;
+  }
+  junco::ProfileTrace::stop();
+  EXPECT_FALSE(junco::ProfileTrace::is_capturing());
+
+  auto file = std::ifstream(path);
+  auto text = std::string(std::istreambuf_iterator<char>(file), {});
+  EXPECT_TRUE(text.starts_with(R"({"traceEvents":[)"));
+  EXPECT_TRUE(text.ends_with("}\n"));
+  auto count = [&text](std::string_view pattern) {
+    auto found = 0;
+    for (auto at = text.find(pattern); at != std::string::npos;
+         at = text.find(pattern, at + 1))
+      ++found;
+    return found;
+  };
+  EXPECT_EQ(count(R"("name":"update \"quoted\"","cat":"zone","ph":"X")"), 3);
+  EXPECT_EQ(count(R"("name":"job","cat":"zone","ph":"X")"), 3);
+  // Each job runs on a new thread, with its own track
+  EXPECT_EQ(count(R"("name":"thread_name")"), 4);
+  EXPECT_EQ(count(R"("ph":"i","s":"g")"), 3);
+  EXPECT_EQ(count(std::format(R"("name":"frame {}")", frames)), 1);
+  std::filesystem::remove(path);
+}
+
+/**
+ * JC_PROFILE_SCOPE should only record zones when profiling is enabled.
+ */
+TEST(ProfilerTests, Macro) {
+  junco::Profiler::end_frame();
+  {
+    JC_PROFILE_SCOPE("macro");
+    JC_PROFILE_SCOPE("nested");
+  }
+  const auto &frame = junco::Profiler::end_frame();
+#if defined(JC_ENABLE_PROFILING)
+  ASSERT_EQ(frame.nodes.size(), 2);
+  EXPECT_EQ(frame.nodes[1].parent, 0);
+#else
+  EXPECT_TRUE(frame.nodes.empty());
+#endif
+}
+
+/**
+ * A trace still being captured when the program exits should be completed,
+ * with the zones collected so far.
+ */
+TEST(ProfilerTests, TraceAtExit) {
+  auto path = std::filesystem::temp_directory_path() / "junco_exit_trace.json";
+  EXPECT_EXIT(
+      {
+        if (!junco::ProfileTrace::start(path))
+          std::exit(1);
+        {
+          auto zone = junco::ProfileScope("last zone");
+        }
+        junco::Profiler::end_frame();
+        std::exit(0);
+      },
+      testing::ExitedWithCode(0), "");
+  auto file = std::ifstream(path);
+  auto text = std::string(std::istreambuf_iterator<char>(file), {});
+  EXPECT_NE(text.find(R"("name":"last zone")"), std::string::npos);
+  EXPECT_TRUE(text.ends_with("}\n"));
+  std::filesystem::remove(path);
+}
\ No newline at end of file
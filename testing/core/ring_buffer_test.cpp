@@ -0,0 +1,67 @@
+#include "junco/ring_buffer.hpp"
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+TEST(RingBufferTests, Capacity) {
+  auto buffer = junco::RingBuffer<int>(100);
+  ASSERT_EQ(buffer.capacity(), 128);
+  ASSERT_TRUE(buffer.empty());
+}
+
+/**
+ * Values should come out in the order they were pushed, and pushing into a
+ * full buffer should fail.
+ */
+TEST(RingBufferTests, FirstInFirstOut) {
+  auto buffer = junco::RingBuffer<int>(4);
+  for (int i = 0; i < 4; ++i)
+    ASSERT_TRUE(buffer.try_push(int{i}));
+  ASSERT_FALSE(buffer.try_push(4));
+  ASSERT_EQ(buffer.size(), 4);
+
+  int value = -1;
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_TRUE(buffer.try_pop(value));
+    EXPECT_EQ(value, i);
+  }
+  ASSERT_FALSE(buffer.try_pop(value));
+}
+
+/**
+ * Several producers push into a small buffer while one consumer drains it.
+ * Every value must arrive exactly once.
+ */
+TEST(RingBufferTests, MultipleProducers) {
+  constexpr int producer_count = 4;
+  constexpr int values_per_producer = 10000;
+  auto buffer = junco::RingBuffer<int>(64);
+
+  auto producers = std::vector<std::thread>();
+  for (int p = 0; p < producer_count; ++p) {
+    producers.push_back(std::thread([&buffer, p] {
+      for (int i = 0; i < values_per_producer; ++i) {
+        auto value = p * values_per_producer + i;
+        while (!buffer.try_push(std::move(value)))
+          std::this_thread::yield();
+      }
+    }));
+  }
+
+  auto seen = std::vector<int>(producer_count * values_per_producer, 0);
+  int received = 0;
+  int value = 0;
+  while (received < producer_count * values_per_producer) {
+    if (buffer.try_pop(value)) {
+      ++seen[value];
+      ++received;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  for (auto &producer : producers)
+    producer.join();
+
+  for (auto count : seen)
+    ASSERT_EQ(count, 1);
+}
@@ -1,9 +1,7 @@
 #include "junco/time.hpp"
 #include <gtest/gtest.h>
 #include <iostream>
-#include <thread> // std::this_thread::sleep_for
-
-// #define LONG_TESTS // Comment out to ignore tests with sleeping
+#include <type_traits>
 
 TEST(ClockTests, Time) {
   auto clock = junco::Clock{};
@@ -16,6 +14,27 @@ TEST(ClockTests, LocalTime) {
   std::cout << clock.get_local_time() << std::endl;
 }
 
+/**
+ * Converting ticks from now_ticks() should give the same local time as reading
+ * the system clock, and keep working after the time zone is looked up again.
+ */
+TEST(ClockTests, LocalTimeFromTicks) {
+  auto clock = junco::Clock{};
+  auto milliseconds_of_day = [](const junco::Time &time) {
+    return (time.hours + time.minutes + time.seconds + time.milliseconds)
+        .count();
+  };
+  for (int i = 0; i < 2; ++i) {
+    auto ticks = clock.now_ticks();
+    auto from_ticks = milliseconds_of_day(clock.get_local_time(ticks));
+    auto direct = milliseconds_of_day(clock.get_local_time());
+    // Allow for drift between the clocks, and for midnight
+    auto difference = (direct - from_ticks + 86'400'000) % 86'400'000;
+    EXPECT_TRUE(difference < 1000 || difference > 86'400'000 - 1000);
+    clock.refresh_time_zone();
+  }
+}
+
 TEST(StopwatchTests, InvalidStart) {
   auto clock = junco::Clock{};
   auto sw = junco::Stopwatch(clock);
@@ -23,17 +42,100 @@ TEST(StopwatchTests, InvalidStart) {
   ASSERT_FALSE(sw.started());
 }
 
-// TODO: Make this not use std::this_thread::sleep_for
-// Introduce mock std::chrono clocks to pass to clock's template
 TEST(StopwatchTests, RecordTime) {
-#ifdef LONG_TESTS
   using namespace std::chrono_literals;
-  auto clock = junco::Clock{};
-  auto sw = junco::Stopwatch(clock);
+  auto clock = junco::BasicClock<junco::ManualClock>{};
+  auto sw = junco::BasicStopwatch(clock);
   sw.start();
-  std::this_thread::sleep_for(1s);
-  ASSERT_GE(sw.stop(), 1);
+  junco::ManualClock::advance(1s);
+  ASSERT_EQ(sw.get_time(), 1);
+  junco::ManualClock::advance(250ms);
+  ASSERT_EQ(sw.stop(), 1.25);
   ASSERT_EQ(sw.stop(), 0);
   ASSERT_EQ(sw.get_time(), 0);
-#endif
+}
+
+/**
+ * Tick counts and typed durations should be exact.
+ */
+TEST(StopwatchTests, RecordTicks) {
+  using namespace std::chrono_literals;
+  auto clock = junco::BasicClock<junco::ManualClock>{};
+  auto sw = junco::BasicStopwatch(clock);
+  EXPECT_EQ(sw.get_ticks(), 0);
+  sw.start();
+  junco::ManualClock::advance(1500us);
+  EXPECT_EQ(sw.get_ticks(), 1'500'000);
+  EXPECT_EQ(sw.get_elapsed(), 1500us);
+  EXPECT_EQ(clock.get_elapsed(), 1500us);
+  junco::ManualClock::advance(1ns);
+  EXPECT_EQ(sw.stop_ticks(), 1'500'001);
+  EXPECT_EQ(sw.get_elapsed(), 0ns);
+}
+
+/**
+ * A manual clock only moves when advanced, and never backwards.
+ */
+TEST(ClockTests, ManualClock) {
+  using namespace std::chrono_literals;
+  auto clock = junco::BasicClock<junco::ManualClock>{};
+  EXPECT_EQ(clock.now_ticks(), 0);
+  junco::ManualClock::advance(16ms);
+  EXPECT_EQ(clock.now_ticks(), 16'000'000);
+  junco::ManualClock::advance(-1s);
+  EXPECT_EQ(clock.get_time(), 0.016);
+
+  // Local times follow the ticks from the moment the clock was created
+  auto start = clock.get_local_time(0);
+  auto later = clock.get_local_time(clock.now_ticks());
+  auto elapsed = (later.seconds + later.milliseconds) -
+                 (start.seconds + start.milliseconds);
+  EXPECT_TRUE(elapsed == 16ms || elapsed == 16ms - 60s);
+}
+
+/**
+ * The timestamp counter should agree with steady_clock, whose epoch it shares,
+ * and never go backwards.
+ */
+TEST(ClockTests, TscClock) {
+  using namespace std::chrono_literals;
+  auto steady = [] {
+    return std::chrono::duration_cast<junco::TscClock::duration>(
+        std::chrono::steady_clock::now().time_since_epoch());
+  };
+  auto before = steady();
+  auto now = junco::TscClock::now().time_since_epoch();
+  auto after = steady();
+  EXPECT_GE(now, before - 1ms);
+  EXPECT_LE(now, after + 1ms);
+
+  auto previous = junco::TscClock::now();
+  for (int i = 0; i < 1000; ++i) {
+    auto next = junco::TscClock::now();
+    ASSERT_GE(next, previous);
+    previous = next;
+  }
+  std::cout << "TscClock reads the "
+            << (junco::TscClock::uses_counter() ? "timestamp counter"
+                                                : "steady clock")
+            << std::endl;
+}
+
+/**
+ * Clocks should stay copyable, with copies keeping the original's start and
+ * time zone.
+ */
+TEST(ClockTests, Copy) {
+  static_assert(std::is_copy_constructible_v<junco::Clock>);
+  static_assert(std::is_copy_assignable_v<junco::Clock>);
+  auto clock = junco::Clock{};
+  auto copy = clock;
+  EXPECT_GE(copy.get_time(), clock.get_time() - 1.0);
+  auto ticks = clock.now_ticks();
+  auto original = clock.get_local_time(ticks);
+  auto copied = copy.get_local_time(ticks);
+  EXPECT_EQ(copied.hours, original.hours);
+  EXPECT_EQ(copied.milliseconds, original.milliseconds);
+  copy = junco::Clock{};
+  EXPECT_EQ(copy.get_local_date().year, clock.get_local_date().year);
 }
\ No newline at end of file
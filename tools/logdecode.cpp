@@ -0,0 +1,86 @@
+/**
+ * junco_logdecode: renders binary logs written by junco::BinaryLogSink as
+ * text.
+ *
+ * Usage: junco_logdecode [--level <level>] [--from <seconds>] [--to <seconds>]
+ *                        [--thread <index>] <file>
+ */
+#include "junco/binary_log.hpp"
+#include <array>
+#include <charconv>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string_view>
+#include <system_error>
+
+namespace {
+constexpr std::array<std::string_view, 5> level_names{
+    "trace", "standard", "warning", "error", "fatal"};
+
+template <typename T> bool parse_number(std::string_view text, T &value) {
+  auto *last = text.data() + text.size();
+  auto [end, ec] = std::from_chars(text.data(), last, value);
+  return ec == std::errc() && end == last;
+}
+
+bool parse_level(std::string_view text, junco::LogLevel &level) {
+  for (std::size_t i = 0; i < level_names.size(); ++i) {
+    if (level_names[i] == text) {
+      level = static_cast<junco::LogLevel>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+int usage() {
+  std::cerr << "Usage: junco_logdecode [--level <level>] [--from <seconds>] "
+               "[--to <seconds>] [--thread <index>] <file>\n"
+               "Levels: trace, standard, warning, error, fatal\n";
+  return 2;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  auto filter = junco::BinaryLogFilter{};
+  auto path = std::string_view();
+  for (int i = 1; i < argc; ++i) {
+    auto arg = std::string_view(argv[i]);
+    if (!arg.starts_with("--")) {
+      if (!path.empty())
+        return usage();
+      path = arg;
+      continue;
+    }
+    if (i + 1 == argc)
+      return usage();
+    auto value = std::string_view(argv[++i]);
+    auto valid = false;
+    if (arg == "--level") {
+      valid = parse_level(value, filter.minimum);
+    } else if (arg == "--from") {
+      valid = parse_number(value, filter.from.emplace());
+    } else if (arg == "--to") {
+      valid = parse_number(value, filter.to.emplace());
+    } else if (arg == "--thread") {
+      valid = parse_number(value, filter.thread.emplace());
+    }
+    if (!valid)
+      return usage();
+  }
+  if (path.empty())
+    return usage();
+
+  auto file = std::ifstream(std::string(path), std::ios::binary);
+  if (!file) {
+    std::cerr << "junco_logdecode: cannot open " << path << "\n";
+    return 1;
+  }
+  if (!junco::decode_binary_log(file, std::cout, filter)) {
+    std::cerr << "junco_logdecode: " << path
+              << " is not a junco binary log, or is truncated\n";
+    return 1;
+  }
+  return 0;
+}
\ No newline at end of file
@@ -0,0 +1,28 @@
+/**
+ * junco_logreceive: a reference receiver for junco::SocketSink, which prints
+ * every record sent to a socket path until interrupted.
+ *
+ * Usage: junco_logreceive <socket path>
+ */
+#include "junco/log_sinks.hpp"
+#include <iostream>
+#include <string>
+#include <string_view>
+
+int main(int argc, char **argv) {
+  if (argc != 2) {
+    std::cerr << "Usage: junco_logreceive <socket path>\n";
+    return 2;
+  }
+  auto path = std::string_view(argv[1]);
+  auto receiver = junco::LogSocketReceiver(path);
+  if (!receiver.is_open()) {
+    std::cerr << "junco_logreceive: cannot bind a socket at " << path << "\n";
+    return 1;
+  }
+  auto record = std::string();
+  for (;;) {
+    if (receiver.receive(record, 1.0))
+      std::cout << record << std::flush;
+  }
+}
\ No newline at end of file